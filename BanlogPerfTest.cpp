@@ -0,0 +1,75 @@
+#include <FileReaderTestUtils.hpp>
+
+#include <sys/wait.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+const char* filename = "./banlog_perf.log";
+const char* outname = "./banlog_perf.out";
+
+struct FileRemover
+{
+    ~FileRemover()
+    {
+        for (const char* sName : {filename, outname})
+            if (remove(sName) != 0)
+                std::cerr << "Failed to remove " << sName << "!" << std::endl;
+    }
+};
+
+static void checkpoint(const char* aText, size_t aBytes)
+{
+    using namespace std::chrono;
+    high_resolution_clock::time_point now = high_resolution_clock::now();
+    static high_resolution_clock::time_point was;
+    duration<double> time_span = duration_cast<duration<double>>(now - was);
+    if (0 != aBytes)
+    {
+        double MBps = aBytes / 1024. / 1024. / time_span.count();
+        if (MBps < 1024)
+            std::cout << aText << ":\t" << MBps << " MB/s" << std::endl;
+        else
+            std::cout << aText << ":\t" << MBps / 1024 << " GB/s" << std::endl;
+    }
+    was = now;
+}
+
+// The same search by banlog (built next to this test) and GNU grep -F in the
+// C locale. The output goes to a file: grep stops at the first match when
+// it sees its output is /dev/null.
+void run(const char* aName, const std::string& aArgs, size_t aSize)
+{
+    std::cout << aName << ": " << aArgs << std::endl;
+    for (const char* sTool : {"./banlog", "LC_ALL=C grep -F"})
+    {
+        std::string sCommand = std::string(sTool) + " " + aArgs + " " + filename + " > " + outname;
+        checkpoint("", 0);
+        int sStatus = std::system(sCommand.c_str());
+        checkpoint(sTool[0] == '.' ? "banlog" : "grep  ", aSize);
+        if (sStatus == -1 || !WIFEXITED(sStatus) || WEXITSTATUS(sStatus) > 1)
+            std::cout << "Failed: " << sCommand << std::endl;
+    }
+    std::cout << std::endl;
+}
+
+int main(int argc, char** argv)
+{
+    // File size in MB, the page cache is expected to be warm after generation.
+    size_t sSizeMB = argc > 1 ? atoll(argv[1]) : 2048;
+    size_t sSize = sSizeMB * 1024 * 1024;
+    generateLog(filename, sSize);
+    FileRemover sRemover;
+
+    run("rare, count", "-c -e 'banned banned id=1'", sSize);
+    run("rare, lines", "-e 'banned banned id=1'", sSize);
+    run("frequent, count", "-c -e 'user banned'", sSize);
+    run("frequent, lines", "-e 'user banned'", sSize);
+    run("frequent, line numbers", "-n -e 'user banned'", sSize);
+    run("ignore case", "-c -i -e 'USER BANNED'", sSize);
+    run("files only", "-l -e 'banned banned id=1'", sSize);
+    run("several patterns", "-c -e 'user banned' -e 'cache miss' -e 'retry timeout'", sSize);
+}
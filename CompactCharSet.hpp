@@ -2,9 +2,18 @@
 
 #include <cstdint>
 #include <cstdlib>
+#include <cstring>
+#include <type_traits>
 #include <utility>
 
+#ifdef __SSE2__
+#include <immintrin.h>
+#endif
+
 #if 1
+// The values are kept as 255 - v in 9 bit lanes: adding c carries into the
+// 9th bit of the lanes of the values below c, and one more gives a carry
+// in the lane of c itself.
 class CompactCharSet7
 {
 public:
@@ -14,23 +23,95 @@ public:
     {
         m_Index = 0;
         for (size_t i = 0; i < 7; i++)
-            m_Index |= static_cast<uint64_t>(aSortedValues[i]) << (i * 8);
-        m_Index = ~m_Index;
+            m_Index |= (255ull - aSortedValues[i]) << (i * 9);
     }
     std::pair<bool, size_t> find(unsigned char c) const
     {
-        //uint64_t mask = 0x0101010101010101ull;
-        uint64_t mask = 0x0001010101010101ull;
-        uint64_t a = mask * c;
-        a ^= m_Index;
-        a = (a & 0x80808080808080) & ((a & 0x7f7f7f7f7f7f7f) + mask);
-        a >>= 7;
-        bool sMatch = 0 != a;
-        uint64_t sPos = (0x0001020304050607ull * a) >> 56;
+        const uint64_t sLoMask = 0x0040201008040201ull;
+        const uint64_t sHiMask = sLoMask << 8;
+        uint64_t sSum = m_Index + c * sLoMask;
+        bool sMatch = ((sSum ^ (sSum + sLoMask)) & sHiMask) != 0;
+        // The carries are summed up in the last lane.
+        uint64_t sPos = ((((sSum & sHiMask) >> 8) * sLoMask) >> 54) & 0x1ff;
         return std::pair<bool, size_t>(sMatch, sPos);
     }
+    static constexpr size_t size() { return 7; }
+
+    static constexpr size_t BLOCK = 32;
+
+    // Membership of BLOCK consecutive bytes at once: bit i of the result is
+    // set if aBlock[i] is in the set. AVX2 (or SSE2) compares the block with
+    // every value; the scalar version checks 8 bytes in a word for a zero
+    // byte after xor with each value.
+    uint32_t findBlock(const unsigned char* aBlock) const
+    {
+#if defined(__AVX2__)
+        const __m256i sBlock = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(aBlock));
+        __m256i sMatch = _mm256_setzero_si256();
+        for (size_t i = 0; i < 7; i++)
+            sMatch = _mm256_or_si256(sMatch, _mm256_cmpeq_epi8(sBlock, _mm256_set1_epi8(static_cast<char>(value(i)))));
+        return _mm256_movemask_epi8(sMatch);
+#elif defined(__SSE2__)
+        const __m128i sLo = _mm_loadu_si128(reinterpret_cast<const __m128i*>(aBlock));
+        const __m128i sHi = _mm_loadu_si128(reinterpret_cast<const __m128i*>(aBlock + 16));
+        __m128i sMatchLo = _mm_setzero_si128();
+        __m128i sMatchHi = _mm_setzero_si128();
+        for (size_t i = 0; i < 7; i++)
+        {
+            const __m128i sValue = _mm_set1_epi8(static_cast<char>(value(i)));
+            sMatchLo = _mm_or_si128(sMatchLo, _mm_cmpeq_epi8(sLo, sValue));
+            sMatchHi = _mm_or_si128(sMatchHi, _mm_cmpeq_epi8(sHi, sValue));
+        }
+        return static_cast<uint32_t>(_mm_movemask_epi8(sMatchLo)) | static_cast<uint32_t>(_mm_movemask_epi8(sMatchHi)) << 16;
+#else
+        uint32_t sResult = 0;
+        for (size_t j = 0; j < BLOCK; j += 8)
+        {
+            uint64_t sWord;
+            memcpy(&sWord, aBlock + j, 8);
+            uint64_t sZero = 0;
+            for (size_t i = 0; i < 7; i++)
+            {
+                uint64_t a = sWord ^ (0x0101010101010101ull * value(i));
+                sZero |= ~(((a & 0x7f7f7f7f7f7f7f7full) + 0x7f7f7f7f7f7f7f7full) | a | 0x7f7f7f7f7f7f7f7full);
+            }
+            // The high bit of byte k goes to bit k.
+            sResult |= static_cast<uint32_t>(((sZero >> 7) * 0x0102040810204080ull) >> 56) << j;
+        }
+        return sResult;
+#endif
+    }
+
+    // The same, and aPositions[i] is the index of aBlock[i] in the set for
+    // the matched bytes.
+    uint32_t findBlock(const unsigned char* aBlock, unsigned char* aPositions) const
+    {
+#if defined(__AVX2__)
+        const __m256i sBlock = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(aBlock));
+        __m256i sMatch = _mm256_setzero_si256();
+        __m256i sPositions = _mm256_setzero_si256();
+        for (size_t i = 0; i < 7; i++)
+        {
+            __m256i sEqual = _mm256_cmpeq_epi8(sBlock, _mm256_set1_epi8(static_cast<char>(value(i))));
+            sMatch = _mm256_or_si256(sMatch, sEqual);
+            sPositions = _mm256_or_si256(sPositions, _mm256_and_si256(sEqual, _mm256_set1_epi8(i)));
+        }
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(aPositions), sPositions);
+        return _mm256_movemask_epi8(sMatch);
+#else
+        uint32_t sResult = findBlock(aBlock);
+        for (uint32_t sMask = sResult; sMask != 0; sMask &= sMask - 1)
+        {
+            size_t i = __builtin_ctz(sMask);
+            aPositions[i] = find(aBlock[i]).second;
+        }
+        return sResult;
+#endif
+    }
 
 private:
+    unsigned char value(size_t i) const { return static_cast<unsigned char>(255 - ((m_Index >> (i * 9)) & 0x1ff)); }
+
     uint64_t m_Index;
 };
 #endif
@@ -62,7 +143,130 @@ private:
 };
 #endif
 
-class CompactCharSet63
+// Up to 63 sorted bytes compared with the searched one at once: SSE2
+// compares (AVX2 ones when built for it), movemask gives a bit per value and
+// ctz the position. The values are padded to 16, 32 or 64 bytes, the padding
+// is masked out.
+template <size_t SIZE>
+class CompactCharSetVec
+{
+public:
+    static_assert(SIZE > 0 && SIZE < 64, "Expected 1 to 63 values");
+
+    CompactCharSetVec() { }
+    CompactCharSetVec(const unsigned char* aValues) { build(aValues); }
+    void build(const unsigned char* aSortedValues)
+    {
+        memcpy(m_Values, aSortedValues, SIZE);
+        memset(m_Values + SIZE, 0, STORAGE - SIZE);
+    }
+    std::pair<bool, size_t> find(unsigned char c) const
+    {
+        // Bit i is set if m_Values[i] >= c (unsigned: max(v, c) == v). The
+        // values are sorted, so the rank is the first set bit, and the
+        // value there (padding after the last one) is c on a hit.
+        uint64_t sMask = 0;
+#if defined(__AVX2__)
+        if constexpr (STORAGE == 64)
+        {
+            const __m256i sChar = _mm256_set1_epi8(static_cast<char>(c));
+            const __m256i sLo = _mm256_load_si256(reinterpret_cast<const __m256i*>(m_Values));
+            const __m256i sHi = _mm256_load_si256(reinterpret_cast<const __m256i*>(m_Values + 32));
+            __m256i a = _mm256_cmpeq_epi8(sLo, _mm256_max_epu8(sLo, sChar));
+            __m256i b = _mm256_cmpeq_epi8(sHi, _mm256_max_epu8(sHi, sChar));
+            sMask = static_cast<uint32_t>(_mm256_movemask_epi8(a)) | static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(b))) << 32;
+        }
+        else
+#endif
+#if defined(__SSE2__)
+        {
+            const __m128i sChar = _mm_set1_epi8(static_cast<char>(c));
+            for (size_t i = 0; i < STORAGE; i += 16)
+            {
+                const __m128i sValues = _mm_load_si128(reinterpret_cast<const __m128i*>(m_Values + i));
+                __m128i a = _mm_cmpeq_epi8(sValues, _mm_max_epu8(sValues, sChar));
+                sMask |= static_cast<uint64_t>(_mm_movemask_epi8(a)) << i;
+            }
+        }
+#else
+        {
+            for (size_t i = 0; i < SIZE; i++)
+                sMask |= static_cast<uint64_t>(m_Values[i] >= c) << i;
+        }
+#endif
+        sMask &= (1ull << SIZE) - 1;
+        size_t sPos = __builtin_ctzll(sMask | 1ull << SIZE);
+        // Past the values the padding is 0, which is not c: all the values
+        // are below c, so c > 0.
+        return std::pair<bool, size_t>(m_Values[sPos] == c, sPos);
+    }
+    static constexpr size_t size() { return SIZE; }
+
+private:
+    static constexpr size_t STORAGE = SIZE < 16 ? 16 : SIZE < 32 ? 32 : 64;
+    alignas(STORAGE) unsigned char m_Values[STORAGE];
+};
+
+using CompactCharSet15 = CompactCharSetVec<15>;
+using CompactCharSet31 = CompactCharSetVec<31>;
+using CompactCharSet63 = CompactCharSetVec<63>;
+
+// Any number of values as a 256 bit bitmap. The position is the rank of the
+// byte: the number of values in the preceding words plus the popcount of the
+// lower bits of its own word.
+template <size_t SIZE>
+class CompactCharSetBitmap
 {
+public:
+    static_assert(SIZE > 0 && SIZE <= 256, "Expected 1 to 256 values");
+
+    CompactCharSetBitmap() { }
+    CompactCharSetBitmap(const unsigned char* aValues) { build(aValues); }
+    void build(const unsigned char* aSortedValues)
+    {
+        memset(m_Bits, 0, sizeof(m_Bits));
+        for (size_t i = 0; i < SIZE; i++)
+            m_Bits[aSortedValues[i] >> 6] |= 1ull << (aSortedValues[i] & 63);
+        size_t sRank = 0;
+        for (size_t i = 0; i < 4; i++)
+        {
+            m_Rank[i] = sRank;
+            sRank += popcount(m_Bits[i]);
+        }
+    }
+    std::pair<bool, size_t> find(unsigned char c) const
+    {
+        uint64_t sWord = m_Bits[c >> 6];
+        uint64_t sBit = 1ull << (c & 63);
+        return std::pair<bool, size_t>((sWord & sBit) != 0, m_Rank[c >> 6] + popcount(sWord & (sBit - 1)));
+    }
+    static constexpr size_t size() { return SIZE; }
+
+private:
+    static size_t popcount(uint64_t a)
+    {
+#if defined(__POPCNT__)
+        return __builtin_popcountll(a);
+#else
+        // Without the instruction the builtin is a libgcc call.
+        a -= (a >> 1) & 0x5555555555555555ull;
+        a = (a & 0x3333333333333333ull) + ((a >> 2) & 0x3333333333333333ull);
+        a = (a + (a >> 4)) & 0x0f0f0f0f0f0f0f0full;
+        return (a * 0x0101010101010101ull) >> 56;
+#endif
+    }
+
+    uint64_t m_Bits[4];
+    uint16_t m_Rank[4];
+};
 
-};
\ No newline at end of file
+// A set of SIZE sorted bytes in the fastest representation for the size
+// (see CompactCharSetPerfTest): SWAR for 7 values, SIMD compares up to 32
+// and the bitmap above, where 64 byte compares are no faster and take more
+// memory. find() returns whether the byte is in the set and its rank: the
+// number of values below it. For a byte in the set that is its index in the
+// sorted values (e.g. the index of a sparse transition), for any other byte
+// the index it would be inserted at. All the representations agree on both.
+template <size_t SIZE>
+using CompactCharSet = std::conditional_t<SIZE == 7, CompactCharSet7,
+    std::conditional_t<(SIZE <= 32), CompactCharSetVec<SIZE>, CompactCharSetBitmap<SIZE>>>;
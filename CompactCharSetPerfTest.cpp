@@ -9,10 +9,6 @@
 #include <variant>
 
 const size_t N = 16 * 1024;
-using TestTypes = std::tuple<CompactCharSet7[N], LinearCharSet7[N], LinearHintCharSet7[N], OwnBinaryCharSet7[N],
-    StdLowerBound7[N], MemChr7[N], StdFind7[N], StdStrFind7[N], StdStrViewFind7[N]>;
-
-TestTypes arrs;
 unsigned char fnd[N];
 
 template <class T>
@@ -26,22 +22,42 @@ const char* name(const CompactCharSet7*)
     return "Test   ";
 }
 
-static void checkpoint(const char* aText, size_t aOpCount)
+template <size_t SIZE>
+const char* name(const CompactCharSetVec<SIZE>*)
+{
+    return "Test (SIMD)";
+}
+
+template <size_t SIZE>
+const char* name(const CompactCharSetBitmap<SIZE>*)
+{
+    return "Test (bitmap)";
+}
+
+static double checkpoint(const char* aText, size_t aOpCount)
 {
     using namespace std::chrono;
     high_resolution_clock::time_point now = high_resolution_clock::now();
     static high_resolution_clock::time_point was;
     duration<double> time_span = duration_cast<duration<double>>(now - was);
+    double Mrps = 0;
     if (0 != aOpCount)
     {
-        double Mrps = aOpCount / 1000000. / time_span.count();
+        Mrps = aOpCount / 1000000. / time_span.count();
         std::cout << aText << ":\t" << Mrps << " Mrps" << std::endl;
     }
     was = now;
+    return Mrps;
 }
 
+// CompactCharSet7 looked up by findBlock(), a block of bytes at a time.
+struct BlockCharSet7 : CompactCharSet7
+{
+    static const char* name() { return "Test (block)"; }
+};
+
 template <class T>
-void run(T* aCont)
+double run(T* aCont)
 {
     size_t sum[2] = {0};
     checkpoint("", 0);
@@ -53,24 +69,47 @@ void run(T* aCont)
             sum[r.first] += r.second;
         }
     }
-    checkpoint(name(aCont), N * N);
+    double Mrps = checkpoint(name(aCont), N * N);
     std::cout << "Check: " << sum[1] << std::endl;
+    return Mrps;
 }
 
-int main()
+// The same sums as run() gives for CompactCharSet7.
+double run(BlockCharSet7* aCont)
 {
-    std::tuple<int, double> test = {22, 1.5};
-    auto ff = [](const auto& x) { std::cout << x << std::endl; };
-    std::apply([ff](auto& ... a){ (..., ff(a)); }, test);
+    const size_t BLOCK = CompactCharSet7::BLOCK;
+    size_t sum[2] = {0};
+    unsigned char positions[BLOCK];
+    checkpoint("", 0);
+    for (size_t i = 0; i < N; i++)
+    {
+        for (size_t j = 0; j < N; j += BLOCK)
+        {
+            uint32_t mask = aCont[i].findBlock(fnd + j, positions);
+            for (; mask != 0; mask &= mask - 1)
+                sum[1] += positions[__builtin_ctz(mask)];
+        }
+    }
+    double Mrps = checkpoint(name(aCont), N * N);
+    std::cout << "Check: " << sum[1] << std::endl;
+    return Mrps;
+}
 
-    srand(time(nullptr));
+// The same table for every set type of SIZE elements.
+template <size_t SIZE, class... T>
+void runSize()
+{
+    static std::tuple<T[N]...> arrs;
+    std::cout << "Set size: " << SIZE << std::endl;
     size_t lims[] = {20, 50 ,100, 256};
     for (size_t lim : lims)
     {
+        if (lim <= SIZE)
+            continue;
         std::cout << "Limit: " << lim << std::endl;
         for (size_t i = 0; i < N; i++)
         {
-            const unsigned char* data = generate(7, lim);
+            const unsigned char* data = generate(SIZE, lim);
             std::apply([i, data](auto& ... a) { (..., a[i].build(data)); }, arrs);
             fnd[i] = rand() % lim;
         }
@@ -79,5 +118,68 @@ int main()
 
         std::cout << std::endl;
     }
+}
+
+// Every representation of CompactCharSet that fits SIZE values, on all the
+// bytes. Returns the rates of SWAR, SIMD and bitmap, 0 where not applicable.
+template <size_t SIZE>
+std::tuple<double, double, double> runRepresentations()
+{
+    static CompactCharSet7 sSwar[N];
+    static CompactCharSetVec<SIZE < 64 ? SIZE : 63> sVec[N];
+    static CompactCharSetBitmap<SIZE> sBitmap[N];
+    std::cout << "Set size: " << SIZE << std::endl;
+    for (size_t i = 0; i < N; i++)
+    {
+        const unsigned char* data = generate(SIZE);
+        if constexpr (SIZE == 7)
+            sSwar[i].build(data);
+        if constexpr (SIZE < 64)
+            sVec[i].build(data);
+        sBitmap[i].build(data);
+        fnd[i] = rand();
+    }
+    std::tuple<double, double, double> sResult = {0, 0, 0};
+    if constexpr (SIZE == 7)
+        std::get<0>(sResult) = run(sSwar);
+    if constexpr (SIZE < 64)
+        std::get<1>(sResult) = run(sVec);
+    std::get<2>(sResult) = run(sBitmap);
+    std::cout << std::endl;
+    return sResult;
+}
+
+// Prints the fastest representation of each size and where it changes.
+template <size_t... SIZE>
+void runCrossover()
+{
+    const char* sNames[] = {"SWAR", "SIMD", "bitmap"};
+    size_t sSizes[] = {SIZE...};
+    std::tuple<double, double, double> sRates[] = {runRepresentations<SIZE>()...};
+    size_t sWas = 3;
+    for (size_t i = 0; i < sizeof...(SIZE); i++)
+    {
+        double sValues[] = {std::get<0>(sRates[i]), std::get<1>(sRates[i]), std::get<2>(sRates[i])};
+        size_t sBest = std::max_element(sValues, sValues + 3) - sValues;
+        std::cout << "Size " << sSizes[i] << ":\t" << sNames[sBest];
+        if (sWas != 3 && sBest != sWas)
+            std::cout << "\t<- crossover from " << sNames[sWas];
+        std::cout << std::endl;
+        sWas = sBest;
+    }
+    std::cout << std::endl;
+}
 
-}
\ No newline at end of file
+int main()
+{
+    std::tuple<int, double> test = {22, 1.5};
+    auto ff = [](const auto& x) { std::cout << x << std::endl; };
+    std::apply([ff](auto& ... a){ (..., ff(a)); }, test);
+
+    srand(time(nullptr));
+    runSize<7, CompactCharSet7, BlockCharSet7, LinearCharSet7, LinearHintCharSet7, OwnBinaryCharSet7,
+        StdLowerBound7, MemChr7, StdFind7, StdStrFind7, StdStrViewFind7>();
+    runSize<63, CompactCharSet63, LinearCharSet<63>, LinearHintCharSet<63>,
+        StdLowerBound<63>, MemChr<63>, StdFind<63>, StdStrFind<63>, StdStrViewFind<63>>();
+    runCrossover<7, 8, 15, 16, 24, 31, 32, 48, 63, 64, 128, 255>();
+}
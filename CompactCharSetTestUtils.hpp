@@ -9,60 +9,66 @@
 #include <string>
 #include <string_view>
 
-class LinearCharSet7
+template <size_t N>
+class LinearCharSet
 {
 public:
-    LinearCharSet7() { }
-    LinearCharSet7(const unsigned char* aValues) { build(aValues); }
+    LinearCharSet() { }
+    LinearCharSet(const unsigned char* aValues) { build(aValues); }
     void build(const unsigned char* aSortedValues)
     {
-        for (size_t i = 0; i < 7; i++)
+        for (size_t i = 0; i < N; i++)
             m_Values[i] = aSortedValues[i];
     }
     std::pair<bool, size_t> find(unsigned char a) const
     {
-        for (size_t i = 0; i < 7; i++)
+        for (size_t i = 0; i < N; i++)
         {
             if (m_Values[i] == a)
                 return std::pair<bool, size_t>(true, i);
 //            else if (m_Values[i] > a)
 //                return std::pair<bool, size_t>(false, i);
         }
-        return std::pair<bool, size_t>(false, 7);
+        return std::pair<bool, size_t>(false, N);
     }
     static const char* name() { return "Linear   "; }
 
 private:
-    unsigned char m_Values[7];
+    unsigned char m_Values[N];
 };
 
-class LinearHintCharSet7
+using LinearCharSet7 = LinearCharSet<7>;
+
+template <size_t N>
+class LinearHintCharSet
 {
 public:
-    LinearHintCharSet7() { }
-    LinearHintCharSet7(const unsigned char* aValues) { build(aValues); }
+    LinearHintCharSet() { }
+    LinearHintCharSet(const unsigned char* aValues) { build(aValues); }
     void build(const unsigned char* aSortedValues)
     {
-        for (size_t i = 0; i < 7; i++)
+        for (size_t i = 0; i < N; i++)
             m_Values[i] = aSortedValues[i];
     }
     std::pair<bool, size_t> find(unsigned char a) const
     {
-        for (size_t i = 0; i < 7; i++)
+        for (size_t i = 0; i < N; i++)
         {
             if (m_Values[i] == a)
                 return std::pair<bool, size_t>(true, i);
             else if (m_Values[i] > a)
-                return std::pair<bool, size_t>(false, 7);
+                return std::pair<bool, size_t>(false, N);
         }
-        return std::pair<bool, size_t>(false, 7);
+        return std::pair<bool, size_t>(false, N);
     }
     static const char* name() { return "Linear+hint"; }
 
 private:
-    unsigned char m_Values[7];
+    unsigned char m_Values[N];
 };
 
+using LinearHintCharSet7 = LinearHintCharSet<7>;
+
 class OwnBinaryCharSet7
 {
 public:
@@ -105,40 +111,44 @@ private:
     unsigned char m_Values[7];
 };
 
-class StdLowerBound7
+template <size_t N>
+class StdLowerBound
 {
 public:
-    StdLowerBound7() { }
-    StdLowerBound7(const unsigned char* aValues) { build(aValues); }
+    StdLowerBound() { }
+    StdLowerBound(const unsigned char* aValues) { build(aValues); }
     void build(const unsigned char* aSortedValues)
     {
-        for (size_t i = 0; i < 7; i++)
+        for (size_t i = 0; i < N; i++)
             m_Values[i] = aSortedValues[i];
     }
     std::pair<bool, size_t> find(unsigned char a) const
     {
-        auto p = std::lower_bound(m_Values, m_Values + 7, a);
-        return std::pair<bool, size_t>(p < m_Values + 7 && *p == a, p - m_Values);
+        auto p = std::lower_bound(m_Values, m_Values + N, a);
+        return std::pair<bool, size_t>(p < m_Values + N && *p == a, p - m_Values);
     }
     static const char* name() { return "Binary (std)"; }
 
 private:
-    unsigned char m_Values[7];
+    unsigned char m_Values[N];
 };
 
-class MemChr7
+using StdLowerBound7 = StdLowerBound<7>;
+
+template <size_t N>
+class MemChr
 {
 public:
-    MemChr7() { }
-    MemChr7(const unsigned char* aValues) { build(aValues); }
+    MemChr() { }
+    MemChr(const unsigned char* aValues) { build(aValues); }
     void build(const unsigned char* aSortedValues)
     {
-        for (size_t i = 0; i < 7; i++)
+        for (size_t i = 0; i < N; i++)
             m_Values[i] = aSortedValues[i];
     }
     std::pair<bool, size_t> find(unsigned char a) const
     {
-        const unsigned char* r = (const unsigned char*)memchr(m_Values, a, 7);
+        const unsigned char* r = (const unsigned char*)memchr(m_Values, a, N);
         bool found = r != nullptr;
         if (!found)
             r = m_Values;
@@ -147,40 +157,46 @@ public:
     static const char* name() { return "memchr   "; }
 
 private:
-    unsigned char m_Values[7];
+    unsigned char m_Values[N];
 };
 
-class StdFind7
+using MemChr7 = MemChr<7>;
+
+template <size_t N>
+class StdFind
 {
 public:
-    StdFind7() { }
-    StdFind7(const unsigned char* aValues) { build(aValues); }
+    StdFind() { }
+    StdFind(const unsigned char* aValues) { build(aValues); }
     void build(const unsigned char* aSortedValues)
     {
-        for (size_t i = 0; i < 7; i++)
+        for (size_t i = 0; i < N; i++)
             m_Values[i] = aSortedValues[i];
     }
     std::pair<bool, size_t> find(unsigned char a) const
     {
         const unsigned char* b = m_Values;
-        const unsigned char* e = m_Values + 7;
+        const unsigned char* e = m_Values + N;
         const unsigned char* r = std::find(b, e, a);
         return std::pair<bool, size_t>(r != e, r - m_Values);
     }
     static const char* name() { return "std::find"; }
 
 private:
-    unsigned char m_Values[7];
+    unsigned char m_Values[N];
 };
 
-class StdStrFind7
+using StdFind7 = StdFind<7>;
+
+template <size_t N>
+class StdStrFind
 {
 public:
-    StdStrFind7() { }
-    StdStrFind7(const unsigned char* aValues) { build(aValues); }
+    StdStrFind() { }
+    StdStrFind(const unsigned char* aValues) { build(aValues); }
     void build(const unsigned char* aSortedValues)
     {
-        m_Str = std::string((const char*)aSortedValues, 7);
+        m_Str = std::string((const char*)aSortedValues, N);
     }
     std::pair<bool, size_t> find(unsigned char a) const
     {
@@ -193,28 +209,33 @@ private:
     std::string m_Str;
 };
 
-class StdStrViewFind7
+using StdStrFind7 = StdStrFind<7>;
+
+template <size_t N>
+class StdStrViewFind
 {
 public:
-    StdStrViewFind7() { }
-    StdStrViewFind7(const unsigned char* aValues) { build(aValues); }
+    StdStrViewFind() { }
+    StdStrViewFind(const unsigned char* aValues) { build(aValues); }
     void build(const unsigned char* aSortedValues)
     {
-        for (size_t i = 0; i < 7; i++)
+        for (size_t i = 0; i < N; i++)
             m_Values[i] = aSortedValues[i];
     }
     std::pair<bool, size_t> find(unsigned char a) const
     {
-        std::string_view str((const char*)m_Values, 7);
+        std::string_view str((const char*)m_Values, N);
         size_t r = str.find(a);
         return std::pair<bool, size_t>(r != str.npos, r);
     }
     static const char* name() { return "string_v::find"; }
 
 private:
-    unsigned char m_Values[7];
+    unsigned char m_Values[N];
 };
 
+using StdStrViewFind7 = StdStrViewFind<7>;
+
 inline const unsigned char* generate(size_t n, size_t limit = 256)
 {
     thread_local unsigned char res[256];
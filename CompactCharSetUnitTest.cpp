@@ -3,8 +3,11 @@
 
 #include <assert.h>
 
+#include <algorithm>
+
 #include <iostream>
 #include <stdexcept>
+#include <type_traits>
 
 void check(bool aExpession, const char* aMessage)
 {
@@ -23,6 +26,7 @@ void test7()
         const unsigned char* data = generate(7);
         CompactCharSet7 test(data);
         OwnBinaryCharSet7 ref(data);
+        StdLowerBound7 rank(data);
         for (size_t j = 0; j < 256; j++)
         {
             auto test_res = test.find(j);
@@ -30,6 +34,51 @@ void test7()
             check(test_res.first == ref_res.first, "Failed: hit");
             if (test_res.first)
                 check(test_res.second == ref_res.second, "Failed: position");
+            check(test_res.second == rank.find(j).second, "Failed: rank");
+        }
+    }
+}
+
+void testBlock7()
+{
+    const size_t N = 64 * 1024;
+    for (size_t i = 0; i < N; i++)
+    {
+        const unsigned char* data = generate(7, i % 2 ? 256 : 7 + rand() % 8);
+        CompactCharSet7 test(data);
+        unsigned char block[CompactCharSet7::BLOCK];
+        unsigned char positions[CompactCharSet7::BLOCK];
+        for (size_t j = 0; j < CompactCharSet7::BLOCK; j++)
+            block[j] = i % 2 ? rand() : data[rand() % 7] + rand() % 3;
+        uint32_t mask = test.findBlock(block);
+        check(mask == test.findBlock(block, positions), "Failed: block with positions");
+        for (size_t j = 0; j < CompactCharSet7::BLOCK; j++)
+        {
+            auto ref_res = test.find(block[j]);
+            check(((mask >> j) & 1) == ref_res.first, "Failed: block hit");
+            if (ref_res.first)
+                check(positions[j] == ref_res.second, "Failed: block position");
+        }
+    }
+}
+
+template <class SET>
+void testSet()
+{
+    const size_t SIZE = SET::size();
+    const size_t N = 16 * 1024;
+    for (size_t i = 0; i < N; i++)
+    {
+        const unsigned char* data = generate(SIZE, i % 2 ? 256 : std::min<size_t>(256, SIZE + rand() % 8));
+        SET test(data);
+        StdLowerBound<SIZE> ref(data);
+        for (size_t j = 0; j < 256; j++)
+        {
+            auto test_res = test.find(j);
+            auto ref_res = ref.find(j);
+            check(test_res.first == ref_res.first, "Failed: hit");
+            // The rank, on a miss too: the same for all the representations.
+            check(test_res.second == ref_res.second, "Failed: position");
         }
     }
 }
@@ -39,6 +88,22 @@ int main()
     try
     {
         test7();
+        testBlock7();
+        testSet<CompactCharSet15>();
+        testSet<CompactCharSet31>();
+        testSet<CompactCharSet63>();
+        testSet<CompactCharSetVec<1>>();
+        testSet<CompactCharSetVec<40>>();
+        testSet<CompactCharSetBitmap<1>>();
+        testSet<CompactCharSetBitmap<63>>();
+        testSet<CompactCharSetBitmap<200>>();
+        testSet<CompactCharSetBitmap<256>>();
+        static_assert(std::is_same_v<CompactCharSet<7>, CompactCharSet7>);
+        static_assert(std::is_same_v<CompactCharSet<32>, CompactCharSetVec<32>>);
+        static_assert(std::is_same_v<CompactCharSet<33>, CompactCharSetBitmap<33>>);
+        testSet<CompactCharSet<7>>();
+        testSet<CompactCharSet<20>>();
+        testSet<CompactCharSet<255>>();
     }
     catch (const std::exception& e)
     {
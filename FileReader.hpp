@@ -1,16 +1,31 @@
 #pragma once
 
 #include <fcntl.h>
+#include <poll.h>
 #include <unistd.h>
+#include <sys/inotify.h>
+#include <sys/mman.h>
 #include <sys/types.h>
 #include <sys/stat.h>
 
+#include <cassert>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <condition_variable>
 #include <iterator>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <string_view>
 #include <stdexcept>
-#include <unordered_map>
+#include <new>
+#include <thread>
+#include <utility>
+#include <vector>
 
 #include <IndexedBitset.hpp>
+#include <IoUring.hpp>
 
 template <size_t PAGE_SIZE>
 class FileReader
@@ -19,15 +34,69 @@ class FileReader
     static_assert((PAGE_SIZE & (PAGE_SIZE - 1)) == 0, "Must be power of 2");
 
 public:
-    FileReader(const std::string& aFileName);
+    // READ copies every page into own buffer with read(2).
+    // MMAP maps the whole file and serves pages straight from the mapping,
+    // page lifetime only drives madvise() hints.
+    // IO_URING reads pages into buffers registered in io_uring, several reads
+    // at once; falls back to READ if io_uring is not built in or not permitted.
+    enum class Source { READ, MMAP, IO_URING };
+
+    struct Options
+    {
+        Source m_Source = Source::READ;
+        // Number of pages after the current one (before it, when the page
+        // was reached by operator--) to load in advance: by a background
+        // thread for READ, by MADV_WILLNEED for MMAP, by one batch of
+        // asynchronous reads for IO_URING. 0 - disabled.
+        size_t m_ReadaheadPages = 0;
+        // Pages preallocated in the page pool, the pool grows by the same
+        // amount when exhausted. 0 - enough for one iterator with readahead.
+        size_t m_PoolPages = 0;
+        // Budget of resident pages. Pages released by all iterators stay
+        // cached, the least recently used of them are evicted when the
+        // budget is exceeded; should be greater than m_ReadaheadPages.
+        // 0 - no cache, unreferenced pages are released lowest first, or
+        // highest first while scanning backward.
+        size_t m_CachePages = 0;
+        // Follow the file like tail -f: wait() and refresh() pick up
+        // appended data, an iterator at the end keeps the partial last
+        // page to continue on it without rereading.
+        bool m_Follow = false;
+        // Period of wait() checks when inotify is not available, also
+        // bounds a single inotify wait.
+        size_t m_PollMs = 100;
+    };
+
+    enum class Change { NONE, GREW, REOPENED };
+
+    FileReader(const std::string& aFileName) : FileReader(aFileName, Options()) {}
+    FileReader(const std::string& aFileName, const Options& aOptions);
     ~FileReader();
 
-    class iterator : std::iterator<std::bidirectional_iterator_tag, char>
+    // Checks the file. Appended data extends the reader, iterators at the
+    // end see it. The rest of a rotated file is picked up first, then the
+    // reader reopens the file the name points to; it also does so if the
+    // file was truncated. Reopening invalidates all iterators, they may
+    // only be destroyed or assigned.
+    Change refresh();
+    // Like refresh(), but waits up to aTimeoutMs for a change.
+    Change wait(size_t aTimeoutMs);
+
+    class reverse_iterator;
+
+    class iterator
     {
     public:
+        using iterator_category = std::bidirectional_iterator_tag;
+        using value_type = char;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const char*;
+        using reference = char;
+
         iterator() = delete;
         ~iterator();
-        iterator(FileReader& aReader, size_t aPos);
+        // aBackward - the scan goes backward, for readahead.
+        iterator(FileReader& aReader, size_t aPos, bool aBackward = false);
         iterator(const iterator& a);
         iterator(iterator&& a) noexcept;
         iterator& operator=(const iterator& a);
@@ -38,151 +107,757 @@ public:
         char operator[](size_t aAdvance) const;
         iterator& operator++();
         iterator operator++(int);
+        // Stays at 0 at the beginning, steps from end() to the last byte.
+        iterator& operator--();
+        iterator operator--(int);
+        // The rest of the current page, empty at the end. Valid while the
+        // iterator stays on the page.
+        std::string_view span() const;
+        iterator& advance(size_t aCount);
         bool operator==(const iterator& a) const { return m_Pos == a.m_Pos; }
         bool operator!=(const iterator& a) const { return m_Pos != a.m_Pos; }
 
     private:
+        friend class reverse_iterator;
+        bool valid() const;
+        Page* page() const;
+
         FileReader& m_Reader;
         size_t m_Pos;
-        Page* m_Page;
+        mutable Page* m_Page; // Attached on demand after the file has grown.
     };
 
     iterator begin() { return iterator(*this, 0); }
     iterator end() { return iterator(*this, m_Size); }
     iterator at(size_t aPos)  { return iterator(*this, aPos); }
 
+    // Reverse scan, e.g. the last lines of a log: only the tail pages are
+    // read, readahead follows the direction. Unlike std::reverse_iterator
+    // it stays on the byte it reads, rend() is end() in disguise and
+    // touches no page.
+    class reverse_iterator
+    {
+    public:
+        using iterator_category = std::bidirectional_iterator_tag;
+        using value_type = char;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const char*;
+        using reference = char;
+
+        explicit reverse_iterator(iterator aItr) : m_Itr(std::move(aItr)) {}
+
+        size_t pos() const { return m_Itr.pos(); }
+        char operator*() const { return *m_Itr; }
+        reverse_iterator& operator++();
+        reverse_iterator operator++(int);
+        reverse_iterator& operator--();
+        reverse_iterator operator--(int);
+        // The forward iterator to the byte after this one.
+        iterator base() const;
+        bool operator==(const reverse_iterator& a) const { return m_Itr == a.m_Itr; }
+        bool operator!=(const reverse_iterator& a) const { return m_Itr != a.m_Itr; }
+
+    private:
+        iterator m_Itr; // At the byte to read, end() for rend().
+    };
+
+    reverse_iterator rbegin() { return reverse_iterator(iterator(*this, m_Size != 0 ? m_Size - 1 : m_Size, true)); }
+    reverse_iterator rend() { return reverse_iterator(end()); }
+
     struct Stats
     {
         size_t m_PageSize = PAGE_SIZE;
         size_t m_PagesCount = 0;
         size_t m_PagesMaxCount = 0;
         size_t m_PagesTotalRead = 0;
+        size_t m_ReadaheadHits = 0; // Page was loaded by readahead in time.
+        size_t m_ReadaheadMisses = 0; // Page was loaded or waited for by the scanner.
+        size_t m_PoolCapacity = 0; // Pages allocated in the page pool.
+        size_t m_PoolAllocations = 0; // Heap allocations made by the page pool.
+        size_t m_CacheHits = 0; // Requested page was resident.
+        size_t m_CacheMisses = 0; // Requested page had to be read.
+        size_t m_CacheEvictions = 0; // Pages evicted to fit m_CachePages.
+        size_t m_Reopens = 0; // The file was rotated or truncated.
         void operator++() { ++m_PagesCount; ++m_PagesTotalRead; if (m_PagesCount > m_PagesMaxCount) ++m_PagesMaxCount; }
         void operator--() { --m_PagesCount; }
     };
 
+    // Not synchronized with the readahead thread.
     const Stats& getStats() const { return m_Stats; }
+    // Waits until the readahead thread has read the current window, so the
+    // stats do not depend on its timing (e.g. in tests).
+    void waitReadahead();
 
 private:
     FileReader(const FileReader&) = delete;
     FileReader&operator=(const FileReader&) = delete;
 
+    static constexpr uint32_t NO_SLOT = UINT32_MAX;
+    static constexpr size_t NO_PAGE = SIZE_MAX;
+    static constexpr size_t CACHE_LINE = 64;
+
     struct Page
     {
-        size_t m_PageNo;
-        size_t m_Size;
+        size_t m_PageNo = 0;
+        size_t m_Size = 0;
         size_t m_ItrCount = 0;
-        char m_Data[PAGE_SIZE];
-        explicit Page(size_t aPageNo = 0, size_t aSize = 0) : m_PageNo(aPageNo), m_Size(aSize) {}
+        bool m_Ready = true; // false while the page is being read asynchronously.
+        bool m_Prefetched = false; // Loaded by readahead and not yet requested.
+        bool m_Orphan = false; // Still referenced after the file was reopened.
+        uint32_t m_Slot = NO_SLOT; // Own index in the page pool.
+        const char* m_Data = nullptr; // m_Buffer or a part of the mapping.
+        char* m_Buffer = nullptr; // PAGE_SIZE bytes of the pool, nullptr for MMAP.
+        Page* m_NextFree = nullptr;
+        // Ready pages with no iterators are linked in LRU list.
+        bool m_InLru = false;
+        Page* m_LruPrev = nullptr;
+        Page* m_LruNext = nullptr;
     };
 
+    struct AlignedDelete
+    {
+        void operator()(char* aData) const { operator delete[](aData, std::align_val_t(CACHE_LINE)); }
+    };
+
+    int openFile(struct stat& aStat) const;
+    const char* mapFile(int aFd, size_t aSize) const;
+    void grow(size_t aSize);
+    void reopen();
+    void startReadahead();
+    void stopReadahead();
+    void watch();
+    Page* findPage(size_t aPageNo);
+    Page& allocPage(size_t aPageNo);
+    void freePage(Page& aPage);
+    void growPool();
     Page& openPage(size_t aPageNo);
-    Page& getPage(size_t aPageNo);
+    Page& getPage(size_t aPageNo, std::unique_lock<std::mutex>& aLock);
     void closePage(Page& aPage);
     void cleanup();
+    Page* acquire(size_t aPageNo, bool aBackward = false);
+    char peek(size_t aPos);
     Page* bless(Page* aPage);
     void curse(Page* aPage);
+    void lruPush(Page& aPage);
+    void lruUnlink(Page& aPage);
+    void trim(size_t aBudget);
+    bool makeRoom();
+    void readPage(Page& aPage, size_t aFrom = 0);
+    void advise(size_t aPageNo, size_t aPageCount, int aAdvice);
+    size_t pageSize(size_t aPageNo) const { return std::min(PAGE_SIZE, m_Size - aPageNo * PAGE_SIZE); }
+    size_t pageCount() const { return (m_Size + PAGE_SIZE - 1) / PAGE_SIZE; }
+    std::unique_lock<std::mutex> lock();
+    void readahead(size_t aPageNo, bool aBackward);
+    void readaheadWorker();
+    bool ringRead(Page& aPage);
+    void ringComplete(bool aWait);
+    void ringCompleted(size_t aPageNo, int aResult);
 
+    std::string m_FileName;
     int m_Fd = -1;
-    size_t m_Size;
+    size_t m_Size = 0;
+    dev_t m_Dev = 0;
+    ino_t m_Ino = 0;
+    Options m_Options;
+    const char* m_Map = nullptr;
+    // Mappings replaced by growth or reopening, pages may still use them.
+    std::vector<std::pair<const char*, size_t>> m_OldMaps;
+    size_t m_Orphans = 0;
+    int m_Inotify = -1; // Follow mode, -1 - polling.
+    int m_FileWatch = -1;
     IndexedBitset m_PageBitset;
-    std::unordered_map<size_t, Page> m_Pages;
     Stats m_Stats;
+
+    // Page pool: pages are allocated by chunks and never freed before the
+    // reader is, unused pages are linked in m_FreePages. Steady state
+    // scanning thus does no heap allocations.
+    std::vector<uint32_t> m_PageSlots; // Page number -> pool slot or NO_SLOT.
+    std::vector<std::unique_ptr<Page[]>> m_PoolPages;
+    std::vector<std::unique_ptr<char[], AlignedDelete>> m_PoolData;
+    size_t m_PoolChunk = 0;
+    Page* m_FreePages = nullptr;
+    Page* m_LruHead = nullptr; // The most recently released.
+    Page* m_LruTail = nullptr;
+    bool m_Backward = false; // Direction of the last iterator move.
+
+    // Page pool, m_PageBitset, m_Stats and readahead window are guarded by
+    // m_Mutex while the readahead thread is running.
+    std::mutex m_Mutex;
+    std::condition_variable m_Cond;
+    std::thread m_Readahead;
+    size_t m_ReadaheadPage = NO_PAGE; // The request that set the window.
+    size_t m_ReadaheadBegin = 0; // Window set by the last page request.
+    size_t m_ReadaheadNext = 0; // The next page to check by readahead thread,
+    size_t m_ReadaheadEnd = 0; // backwards the one after it.
+    bool m_ReadaheadBackward = false;
+    bool m_ReadaheadStop = false;
+
+    // IO_URING: the first chunk of the pool is registered as a fixed buffer.
+    IoUring m_Ring;
 };
 
 // FileReader
 template <size_t PAGE_SIZE>
-inline FileReader<PAGE_SIZE>::FileReader(const std::string& aFileName)
+inline FileReader<PAGE_SIZE>::FileReader(const std::string& aFileName, const Options& aOptions)
+    : m_FileName(aFileName)
+    , m_Options(aOptions)
 {
     struct stat st;
-    int rc = stat(aFileName.c_str(), &st);
-    if (rc != 0)
-        throw std::runtime_error("Failed to find file");
+    m_Fd = openFile(st);
     m_Size = st.st_size;
-    m_Fd = open(aFileName.c_str(), O_RDONLY, 0);
-    if (m_Fd < 0)
-        throw std::runtime_error("Failed to open file");
-    m_PageBitset.create(m_Size);
+    m_Dev = st.st_dev;
+    m_Ino = st.st_ino;
+    if (m_Options.m_Source == Source::MMAP && m_Size != 0)
+    {
+        try
+        {
+            m_Map = mapFile(m_Fd, m_Size);
+        }
+        catch (...)
+        {
+            close(m_Fd);
+            throw;
+        }
+    }
+    m_PageBitset.create(pageCount());
+    m_PageSlots.assign(pageCount(), NO_SLOT);
+    ++m_Stats.m_PoolAllocations;
+    m_PoolChunk = m_Options.m_PoolPages != 0 ? m_Options.m_PoolPages : std::max(m_Options.m_ReadaheadPages + 4, m_Options.m_CachePages);
+    // An empty file is of no interest unless it is followed.
+    bool sActive = m_Size != 0 || m_Options.m_Follow;
+    if (sActive)
+        growPool();
+    if (m_Options.m_Source == Source::IO_URING && sActive)
+    {
+        if (m_Ring.create(2 * (m_Options.m_ReadaheadPages + 1)))
+            m_Ring.registerBuffer(m_PoolData[0].get(), m_PoolChunk * PAGE_SIZE);
+    }
+    if (sActive)
+        startReadahead();
+    if (m_Options.m_Follow)
+        watch();
 }
 
 template <size_t PAGE_SIZE>
 inline FileReader<PAGE_SIZE>::~FileReader()
 {
+    stopReadahead();
+    // The kernel must not write to the pool after it is freed.
+    try
+    {
+        while (m_Ring.inflight() != 0)
+            ringComplete(true);
+    }
+    catch (const std::exception&)
+    {
+    }
+    m_Ring.destroy();
+    if (m_Inotify >= 0)
+        close(m_Inotify);
+    for (const auto& sMap : m_OldMaps)
+        munmap(const_cast<char*>(sMap.first), sMap.second);
+    if (m_Map != nullptr)
+        munmap(const_cast<char*>(m_Map), m_Size);
     if (m_Fd >= 0)
         close(m_Fd);
 }
 
 template <size_t PAGE_SIZE>
-inline typename FileReader<PAGE_SIZE>::Page& FileReader<PAGE_SIZE>::openPage(size_t aPageNo)
+inline int FileReader<PAGE_SIZE>::openFile(struct stat& aStat) const
 {
-    assert(m_Pages.count(aPageNo) == 0);
-    size_t sSize = std::min(PAGE_SIZE, m_Size - aPageNo * PAGE_SIZE);
-    assert(sSize > 0);
+    int rc = stat(m_FileName.c_str(), &aStat);
+    if (rc != 0)
+        throw std::runtime_error("Failed to find file");
+    int sFd = open(m_FileName.c_str(), O_RDONLY, 0);
+    if (sFd < 0)
+        throw std::runtime_error("Failed to open file");
+    // The identity of what was opened, the name may be reused meanwhile.
+    if (fstat(sFd, &aStat) != 0)
+    {
+        close(sFd);
+        throw std::runtime_error("Failed to stat file");
+    }
+    return sFd;
+}
 
-    if (lseek(m_Fd, aPageNo * PAGE_SIZE, SEEK_SET) != static_cast<off_t>(aPageNo * PAGE_SIZE))
-        throw std::runtime_error("Failed to lseek");
+template <size_t PAGE_SIZE>
+inline const char* FileReader<PAGE_SIZE>::mapFile(int aFd, size_t aSize) const
+{
+    void* sMap = mmap(nullptr, aSize, PROT_READ, MAP_PRIVATE, aFd, 0);
+    if (sMap == MAP_FAILED)
+        throw std::runtime_error("Failed to mmap file");
+    madvise(sMap, aSize, MADV_SEQUENTIAL);
+    return static_cast<const char*>(sMap);
+}
 
-    auto [sItr, sDone] = m_Pages.emplace(std::piecewise_construct, std::forward_as_tuple(aPageNo), std::forward_as_tuple(aPageNo, sSize));
-    assert(sDone);
-    Page& sPage = sItr->second;
+template <size_t PAGE_SIZE>
+inline typename FileReader<PAGE_SIZE>::Change FileReader<PAGE_SIZE>::refresh()
+{
+    struct stat st;
+    if (fstat(m_Fd, &st) != 0)
+        throw std::runtime_error("Failed to stat file");
+    size_t sSize = st.st_size;
+    if (sSize > m_Size)
+    {
+        grow(sSize);
+        return Change::GREW;
+    }
+    bool sRotated = stat(m_FileName.c_str(), &st) == 0 && (st.st_dev != m_Dev || st.st_ino != m_Ino);
+    if (sRotated || sSize < m_Size)
+    {
+        reopen();
+        return Change::REOPENED;
+    }
+    return Change::NONE;
+}
 
-    size_t sReaden = 0;
-    do
+template <size_t PAGE_SIZE>
+inline typename FileReader<PAGE_SIZE>::Change FileReader<PAGE_SIZE>::wait(size_t aTimeoutMs)
+{
+    using namespace std::chrono;
+    steady_clock::time_point sDeadline = steady_clock::now() + milliseconds(aTimeoutMs);
+    while (true)
     {
-        ssize_t rc = read(m_Fd, sPage.m_Data + sReaden, sSize - sReaden);
-        if (rc > 0)
+        Change sChange = refresh();
+        if (sChange != Change::NONE)
+            return sChange;
+        steady_clock::time_point sNow = steady_clock::now();
+        if (sNow >= sDeadline)
+            return Change::NONE;
+        size_t sLeft = duration_cast<milliseconds>(sDeadline - sNow).count() + 1;
+        size_t sSlice = std::max<size_t>(1, std::min(sLeft, m_Options.m_PollMs));
+        if (m_Inotify >= 0)
         {
-            sReaden += rc;
+            // Events are only a wakeup, refresh() finds out what happened.
+            pollfd sPoll = { m_Inotify, POLLIN, 0 };
+            if (poll(&sPoll, 1, sSlice) > 0)
+            {
+                char sEvents[4096];
+                while (read(m_Inotify, sEvents, sizeof(sEvents)) > 0)
+                    ;
+            }
         }
-        else if (rc == 0 || errno != EINTR)
+        else
         {
-            m_Pages.erase(aPageNo);
-            throw std::runtime_error("Failed to read");
+            std::this_thread::sleep_for(milliseconds(sSlice));
+        }
+    }
+}
+
+// Watches the file for changes and its directory for a new file with the
+// same name; falls back to polling if inotify is not available.
+template <size_t PAGE_SIZE>
+inline void FileReader<PAGE_SIZE>::watch()
+{
+    if (m_Inotify < 0)
+    {
+        m_Inotify = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (m_Inotify < 0)
+            return;
+        size_t sSlash = m_FileName.find_last_of('/');
+        std::string sDir = sSlash == std::string::npos ? "." : sSlash == 0 ? "/" : m_FileName.substr(0, sSlash);
+        inotify_add_watch(m_Inotify, sDir.c_str(), IN_CREATE | IN_MOVED_TO);
+    }
+    if (m_FileWatch >= 0)
+        inotify_rm_watch(m_Inotify, m_FileWatch);
+    m_FileWatch = inotify_add_watch(m_Inotify, m_FileName.c_str(), IN_MODIFY | IN_ATTRIB | IN_MOVE_SELF | IN_DELETE_SELF);
+    if (m_FileWatch < 0)
+    {
+        close(m_Inotify);
+        m_Inotify = -1;
+    }
+}
+
+// Extends the reader to aSize bytes; the partial last page, if resident,
+// gets the appended bytes in place.
+template <size_t PAGE_SIZE>
+inline void FileReader<PAGE_SIZE>::grow(size_t aSize)
+{
+    std::unique_lock<std::mutex> sLock = lock();
+    size_t sLastNo = m_Size / PAGE_SIZE;
+    Page* sLast = m_Size % PAGE_SIZE != 0 ? findPage(sLastNo) : nullptr;
+    while (sLast != nullptr && !sLast->m_Ready)
+    {
+        if (m_Ring.active())
+            ringComplete(true);
+        else
+            m_Cond.wait(sLock);
+        sLast = findPage(sLastNo);
+    }
+    if (m_Options.m_Source == Source::MMAP)
+    {
+        // Extend the mapping in place if possible. A mapping that had to
+        // move is kept for the pages that still use it.
+        void* sMap = MAP_FAILED;
+        if (m_Map != nullptr)
+            sMap = mremap(const_cast<char*>(m_Map), m_Size, aSize, 0);
+        if (sMap == MAP_FAILED)
+        {
+            const char* sNewMap = mapFile(m_Fd, aSize);
+            if (m_Map != nullptr)
+                m_OldMaps.emplace_back(m_Map, m_Size);
+            sMap = const_cast<char*>(sNewMap);
+        }
+        m_Map = static_cast<const char*>(sMap);
+    }
+    size_t sOldSize = m_Size;
+    m_Size = aSize;
+    if (sLast != nullptr)
+    {
+        size_t sFrom = sLast->m_Size;
+        sLast->m_Size = pageSize(sLastNo);
+        if (m_Map != nullptr)
+        {
+            sLast->m_Data = m_Map + sLastNo * PAGE_SIZE;
+        }
+        else
+        {
+            try
+            {
+                readPage(*sLast, sFrom);
+            }
+            catch (...)
+            {
+                sLast->m_Size = sFrom;
+                m_Size = sOldSize;
+                throw;
+            }
+        }
+    }
+    m_PageBitset.grow(pageCount());
+    m_PageSlots.resize(pageCount(), NO_SLOT);
+    // The window may have been cut by the old end.
+    m_ReadaheadPage = NO_PAGE;
+}
+
+// Drops all pages and opens the file anew, pages still referenced by
+// iterators are orphaned and returned to the pool when released.
+template <size_t PAGE_SIZE>
+inline void FileReader<PAGE_SIZE>::reopen()
+{
+    struct stat st;
+    int sFd = openFile(st);
+    const char* sMap = nullptr;
+    if (m_Options.m_Source == Source::MMAP && st.st_size != 0)
+    {
+        try
+        {
+            sMap = mapFile(sFd, st.st_size);
+        }
+        catch (...)
+        {
+            close(sFd);
+            throw;
         }
-    } while (sReaden != sSize);
+    }
+
+    stopReadahead();
+    while (m_Ring.inflight() != 0)
+        ringComplete(true);
+    while (!m_PageBitset.empty())
+    {
+        Page& sPage = *findPage(m_PageBitset.lowest());
+        if (sPage.m_ItrCount == 0)
+        {
+            closePage(sPage);
+            continue;
+        }
+        lruUnlink(sPage);
+        --m_Stats;
+        m_PageBitset.clear(sPage.m_PageNo);
+        m_PageSlots[sPage.m_PageNo] = NO_SLOT;
+        sPage.m_Prefetched = false;
+        sPage.m_Orphan = true;
+        ++m_Orphans;
+    }
+    if (m_Map != nullptr)
+    {
+        if (m_Orphans != 0)
+            m_OldMaps.emplace_back(m_Map, m_Size);
+        else
+            munmap(const_cast<char*>(m_Map), m_Size);
+    }
+    close(m_Fd);
+
+    m_Fd = sFd;
+    m_Map = sMap;
+    m_Size = st.st_size;
+    m_Dev = st.st_dev;
+    m_Ino = st.st_ino;
+    m_PageBitset.create(pageCount());
+    m_PageSlots.assign(pageCount(), NO_SLOT);
+    m_ReadaheadPage = NO_PAGE;
+    m_ReadaheadBegin = m_ReadaheadNext = m_ReadaheadEnd = 0;
+    m_Backward = false;
+    ++m_Stats.m_Reopens;
+    startReadahead();
+    if (m_Inotify >= 0)
+        watch();
+}
+
+template <size_t PAGE_SIZE>
+inline void FileReader<PAGE_SIZE>::startReadahead()
+{
+    if (m_Options.m_Source != Source::MMAP && !m_Ring.active() && m_Options.m_ReadaheadPages != 0)
+        m_Readahead = std::thread(&FileReader::readaheadWorker, this);
+}
+
+template <size_t PAGE_SIZE>
+inline void FileReader<PAGE_SIZE>::stopReadahead()
+{
+    if (!m_Readahead.joinable())
+        return;
+    {
+        std::lock_guard<std::mutex> sGuard(m_Mutex);
+        m_ReadaheadStop = true;
+    }
+    m_Cond.notify_all();
+    m_Readahead.join();
+    m_ReadaheadStop = false;
+}
+
+template <size_t PAGE_SIZE>
+inline typename FileReader<PAGE_SIZE>::Page* FileReader<PAGE_SIZE>::findPage(size_t aPageNo)
+{
+    uint32_t sSlot = m_PageSlots[aPageNo];
+    if (sSlot == NO_SLOT)
+        return nullptr;
+    return &m_PoolPages[sSlot / m_PoolChunk][sSlot % m_PoolChunk];
+}
+
+template <size_t PAGE_SIZE>
+inline typename FileReader<PAGE_SIZE>::Page& FileReader<PAGE_SIZE>::allocPage(size_t aPageNo)
+{
+    assert(m_PageSlots[aPageNo] == NO_SLOT);
+    makeRoom();
+    if (m_FreePages == nullptr)
+        growPool();
+    Page& sPage = *m_FreePages;
+    m_FreePages = sPage.m_NextFree;
+    sPage.m_PageNo = aPageNo;
+    sPage.m_Size = pageSize(aPageNo);
+    sPage.m_ItrCount = 0;
+    sPage.m_Ready = true;
+    sPage.m_Prefetched = false;
+    sPage.m_Data = sPage.m_Buffer;
+    sPage.m_NextFree = nullptr;
+    m_PageSlots[aPageNo] = sPage.m_Slot;
+    return sPage;
+}
+
+template <size_t PAGE_SIZE>
+inline void FileReader<PAGE_SIZE>::freePage(Page& aPage)
+{
+    assert(m_PageSlots[aPage.m_PageNo] == aPage.m_Slot);
+    m_PageSlots[aPage.m_PageNo] = NO_SLOT;
+    aPage.m_NextFree = m_FreePages;
+    m_FreePages = &aPage;
+}
+
+template <size_t PAGE_SIZE>
+inline void FileReader<PAGE_SIZE>::growPool()
+{
+    size_t sFirst = m_PoolPages.size() * m_PoolChunk;
+    if (sFirst + m_PoolChunk > NO_SLOT)
+        throw std::runtime_error("Page pool is exhausted");
+    std::unique_ptr<Page[]> sPages(new Page[m_PoolChunk]);
+    char* sData = nullptr;
+    if (m_Options.m_Source != Source::MMAP)
+    {
+        m_PoolData.emplace_back(static_cast<char*>(operator new[](m_PoolChunk * PAGE_SIZE, std::align_val_t(CACHE_LINE))));
+        sData = m_PoolData.back().get();
+        ++m_Stats.m_PoolAllocations;
+    }
+    for (size_t i = m_PoolChunk; i > 0; --i)
+    {
+        Page& sPage = sPages[i - 1];
+        sPage.m_Slot = sFirst + i - 1;
+        if (sData != nullptr)
+            sPage.m_Buffer = sData + (i - 1) * PAGE_SIZE;
+        sPage.m_NextFree = m_FreePages;
+        m_FreePages = &sPage;
+    }
+    m_PoolPages.push_back(std::move(sPages));
+    ++m_Stats.m_PoolAllocations;
+    m_Stats.m_PoolCapacity += m_PoolChunk;
+}
+
+template <size_t PAGE_SIZE>
+inline typename FileReader<PAGE_SIZE>::Page& FileReader<PAGE_SIZE>::openPage(size_t aPageNo)
+{
+    assert(pageSize(aPageNo) > 0);
+    Page& sPage = allocPage(aPageNo);
+
+    if (m_Map != nullptr)
+    {
+        sPage.m_Data = m_Map + aPageNo * PAGE_SIZE;
+        advise(aPageNo, 1, MADV_WILLNEED);
+    }
+    else if (m_Ring.active() && ringRead(sPage))
+    {
+        m_Ring.submit(0);
+    }
+    else
+    {
+        try
+        {
+            readPage(sPage);
+        }
+        catch (...)
+        {
+            freePage(sPage);
+            throw;
+        }
+    }
 
     m_PageBitset.set(aPageNo);
     ++m_Stats;
+    lruPush(sPage);
     return sPage;
 }
 
+// Reads the page from aFrom to its end.
+template <size_t PAGE_SIZE>
+inline void FileReader<PAGE_SIZE>::readPage(Page& aPage, size_t aFrom)
+{
+    // pread does not share file offset, so it is safe for readahead thread.
+    size_t sReaden = aFrom;
+    do
+    {
+        ssize_t rc = pread(m_Fd, aPage.m_Buffer + sReaden, aPage.m_Size - sReaden, aPage.m_PageNo * PAGE_SIZE + sReaden);
+        if (rc > 0)
+            sReaden += rc;
+        else if (rc == 0 || errno != EINTR)
+            throw std::runtime_error("Failed to read");
+    } while (sReaden != aPage.m_Size);
+}
+
+// Advice is applied to system pages: WILLNEED rounds the range outwards,
+// DONTNEED rounds it inwards not to drop the neighbours' data.
 template <size_t PAGE_SIZE>
-inline typename FileReader<PAGE_SIZE>::Page& FileReader<PAGE_SIZE>::getPage(size_t aPageNo)
+inline void FileReader<PAGE_SIZE>::advise(size_t aPageNo, size_t aPageCount, int aAdvice)
 {
-    auto sItr = m_Pages.find(aPageNo);
-    if (sItr != m_Pages.end())
-        return sItr->second;
+    static const size_t sSysPage = sysconf(_SC_PAGESIZE);
+    size_t sBegin = aPageNo * PAGE_SIZE;
+    size_t sEnd = std::min((aPageNo + aPageCount) * PAGE_SIZE, m_Size);
+    if (aAdvice == MADV_DONTNEED)
+    {
+        sBegin = (sBegin + sSysPage - 1) / sSysPage * sSysPage;
+        if (sEnd != m_Size)
+            sEnd = sEnd / sSysPage * sSysPage;
+    }
     else
-        return openPage(aPageNo);
+    {
+        sBegin = sBegin / sSysPage * sSysPage;
+    }
+    if (sBegin < sEnd)
+        madvise(const_cast<char*>(m_Map) + sBegin, sEnd - sBegin, aAdvice);
+}
+
+template <size_t PAGE_SIZE>
+inline typename FileReader<PAGE_SIZE>::Page& FileReader<PAGE_SIZE>::getPage(size_t aPageNo, std::unique_lock<std::mutex>& aLock)
+{
+    if (m_Options.m_ReadaheadPages != 0)
+        readahead(aPageNo, m_Backward);
+    bool sOpened = false;
+    bool sWaited = false;
+    while (true)
+    {
+        Page* sFound = findPage(aPageNo);
+        if (sFound == nullptr)
+        {
+            // An asynchronous read has failed and the page was dropped.
+            if (sOpened)
+                throw std::runtime_error("Failed to read");
+            sOpened = true;
+            openPage(aPageNo);
+            continue;
+        }
+        Page& sPage = *sFound;
+        if (!sPage.m_Ready)
+        {
+            sWaited = true;
+            if (m_Ring.active())
+                ringComplete(true);
+            else
+                m_Cond.wait(aLock);
+            continue;
+        }
+        if (m_Options.m_ReadaheadPages != 0 && m_Options.m_Source != Source::MMAP)
+        {
+            if (sOpened || sWaited)
+                ++m_Stats.m_ReadaheadMisses;
+            else if (sPage.m_Prefetched)
+                ++m_Stats.m_ReadaheadHits;
+        }
+        if (sOpened || sWaited)
+            ++m_Stats.m_CacheMisses;
+        else
+            ++m_Stats.m_CacheHits;
+        sPage.m_Prefetched = false;
+        lruUnlink(sPage);
+        lruPush(sPage);
+        return sPage;
+    }
 }
 
 template <size_t PAGE_SIZE>
 inline void FileReader<PAGE_SIZE>::closePage(Page& aPage)
 {
     assert(aPage.m_ItrCount == 0);
+    assert(aPage.m_Ready);
+    if (m_Map != nullptr)
+        advise(aPage.m_PageNo, 1, MADV_DONTNEED);
+    lruUnlink(aPage);
     --m_Stats;
     m_PageBitset.clear(aPage.m_PageNo);
-    m_Pages.erase(aPage.m_PageNo);
+    freePage(aPage);
 }
 
+// A scanner leaves released pages behind: below the current page when
+// moving forward, above it when moving backward. Prefetched pages are
+// ahead of it.
 template <size_t PAGE_SIZE>
 inline void FileReader<PAGE_SIZE>::cleanup()
 {
-    while (!m_Pages.empty())
+    while (!m_PageBitset.empty())
     {
-        size_t sPageNo = m_PageBitset.lowest();
-        Page& sPage = m_Pages[sPageNo];
-        if (sPage.m_ItrCount != 0)
+        Page& sPage = *findPage(m_Backward ? m_PageBitset.highest() : m_PageBitset.lowest());
+        if (sPage.m_ItrCount != 0 || !sPage.m_Ready || sPage.m_Prefetched)
             return;
         closePage(sPage);
     }
 }
 
+// Gets the page and references it at once: unreferenced pages can be
+// evicted by the readahead thread.
+template <size_t PAGE_SIZE>
+inline typename FileReader<PAGE_SIZE>::Page* FileReader<PAGE_SIZE>::acquire(size_t aPageNo, bool aBackward)
+{
+    std::unique_lock<std::mutex> sLock = lock();
+    m_Backward = aBackward;
+    Page& sPage = getPage(aPageNo, sLock);
+    lruUnlink(sPage);
+    ++sPage.m_ItrCount;
+    return &sPage;
+}
+
+template <size_t PAGE_SIZE>
+inline char FileReader<PAGE_SIZE>::peek(size_t aPos)
+{
+    std::unique_lock<std::mutex> sLock = lock();
+    return getPage(aPos / PAGE_SIZE, sLock).m_Data[aPos % PAGE_SIZE];
+}
+
+// Only for pages that are already referenced.
 template <size_t PAGE_SIZE>
 inline typename FileReader<PAGE_SIZE>::Page* FileReader<PAGE_SIZE>::bless(Page* aPage)
 {
     if (aPage != nullptr)
+    {
+        assert(aPage->m_ItrCount != 0);
         ++aPage->m_ItrCount;
+    }
     return aPage;
 }
 
@@ -190,29 +865,332 @@ template <size_t PAGE_SIZE>
 inline void FileReader<PAGE_SIZE>::curse(Page* aPage)
 {
     if (aPage != nullptr)
+    {
+        std::unique_lock<std::mutex> sLock = lock();
         if (--aPage->m_ItrCount == 0)
-            cleanup();
+        {
+            if (aPage->m_Orphan)
+            {
+                // Left by reopen(), the page table does not know it.
+                aPage->m_Orphan = false;
+                aPage->m_NextFree = m_FreePages;
+                m_FreePages = aPage;
+                --m_Orphans;
+                return;
+            }
+            lruPush(*aPage);
+            if (m_Options.m_CachePages == 0)
+            {
+                cleanup();
+            }
+            else
+            {
+                trim(m_Options.m_CachePages);
+                m_Cond.notify_all();
+            }
+        }
+    }
+}
+
+template <size_t PAGE_SIZE>
+inline void FileReader<PAGE_SIZE>::lruPush(Page& aPage)
+{
+    if (aPage.m_InLru || aPage.m_ItrCount != 0 || !aPage.m_Ready || aPage.m_Prefetched)
+        return;
+    aPage.m_InLru = true;
+    aPage.m_LruPrev = nullptr;
+    aPage.m_LruNext = m_LruHead;
+    if (m_LruHead != nullptr)
+        m_LruHead->m_LruPrev = &aPage;
+    else
+        m_LruTail = &aPage;
+    m_LruHead = &aPage;
+}
+
+template <size_t PAGE_SIZE>
+inline void FileReader<PAGE_SIZE>::lruUnlink(Page& aPage)
+{
+    if (!aPage.m_InLru)
+        return;
+    aPage.m_InLru = false;
+    if (aPage.m_LruPrev != nullptr)
+        aPage.m_LruPrev->m_LruNext = aPage.m_LruNext;
+    else
+        m_LruHead = aPage.m_LruNext;
+    if (aPage.m_LruNext != nullptr)
+        aPage.m_LruNext->m_LruPrev = aPage.m_LruPrev;
+    else
+        m_LruTail = aPage.m_LruPrev;
+}
+
+// Evicts the least recently used unreferenced pages while there are more
+// than aBudget resident pages.
+template <size_t PAGE_SIZE>
+inline void FileReader<PAGE_SIZE>::trim(size_t aBudget)
+{
+    while (m_Stats.m_PagesCount > aBudget && m_LruTail != nullptr)
+    {
+        closePage(*m_LruTail);
+        ++m_Stats.m_CacheEvictions;
+    }
+}
+
+// Makes room for one more page within m_CachePages, if possible.
+template <size_t PAGE_SIZE>
+inline bool FileReader<PAGE_SIZE>::makeRoom()
+{
+    if (m_Options.m_CachePages == 0)
+        return true;
+    trim(m_Options.m_CachePages - 1);
+    return m_Stats.m_PagesCount < m_Options.m_CachePages;
+}
+
+template <size_t PAGE_SIZE>
+inline std::unique_lock<std::mutex> FileReader<PAGE_SIZE>::lock()
+{
+    if (m_Readahead.joinable())
+        return std::unique_lock<std::mutex>(m_Mutex);
+    return std::unique_lock<std::mutex>();
+}
+
+template <size_t PAGE_SIZE>
+inline void FileReader<PAGE_SIZE>::waitReadahead()
+{
+    std::unique_lock<std::mutex> sLock = lock();
+    if (!sLock.owns_lock())
+        return;
+    m_Cond.wait(sLock, [this]
+    {
+        bool sPending = m_ReadaheadBackward ? m_ReadaheadBegin < m_ReadaheadNext : m_ReadaheadNext < m_ReadaheadEnd;
+        if (sPending)
+            return false;
+        for (size_t i = m_ReadaheadBegin; i < m_ReadaheadEnd; i++)
+        {
+            const Page* sPage = findPage(i);
+            if (sPage != nullptr && !sPage->m_Ready)
+                return false;
+        }
+        return true;
+    });
+}
+
+// Moves readahead window to the pages following aPageNo in the scan
+// direction: [aPageNo + 1, aPageNo + 1 + N) or [aPageNo - N, aPageNo).
+template <size_t PAGE_SIZE>
+inline void FileReader<PAGE_SIZE>::readahead(size_t aPageNo, bool aBackward)
+{
+    size_t sDepth = m_Options.m_ReadaheadPages;
+    if (m_ReadaheadPage != NO_PAGE)
+    {
+        // The same page or a short step back in the window direction keeps
+        // the window; a step ahead wraps around and moves it. A turn
+        // rebuilds it at once: otherwise the pages the scan turned to are
+        // read only after depth steps.
+        size_t sBehind = m_ReadaheadBackward ? aPageNo - m_ReadaheadPage : m_ReadaheadPage - aPageNo;
+        if (aBackward == m_ReadaheadBackward && sBehind <= sDepth)
+            return;
+    }
+    size_t sBegin = aBackward ? aPageNo - std::min(aPageNo, sDepth) : aPageNo + 1;
+    size_t sEnd = aBackward ? aPageNo : std::min(aPageNo + 1 + sDepth, pageCount());
+    if (m_Map != nullptr)
+    {
+        // Advise only the pages that have not been in the window yet.
+        size_t sTo = std::min(sEnd, std::max(sBegin, m_ReadaheadBegin));
+        if (sBegin < sTo)
+            advise(sBegin, sTo - sBegin, MADV_WILLNEED);
+        size_t sFrom = std::max(sBegin, m_ReadaheadEnd);
+        if (sFrom < sEnd)
+            advise(sFrom, sEnd - sFrom, MADV_WILLNEED);
+    }
+    if (m_Ring.active())
+    {
+        // The requested page goes first in the same batch, then the window
+        // in the scan order.
+        for (size_t j = 0; j <= sEnd - sBegin; j++)
+        {
+            size_t i = aBackward ? aPageNo - j : aPageNo + j;
+            if (findPage(i) != nullptr)
+                continue;
+            if (i != aPageNo && !makeRoom())
+                break;
+            Page& sPage = allocPage(i);
+            if (!ringRead(sPage))
+            {
+                freePage(sPage);
+                break;
+            }
+            sPage.m_Prefetched = i != aPageNo;
+            m_PageBitset.set(i);
+            ++m_Stats;
+        }
+        m_Ring.submit(0);
+    }
+    // Prefetched pages are protected from eviction until requested or
+    // until they are left out of the window.
+    for (size_t i = m_ReadaheadBegin; i < m_ReadaheadEnd; i++)
+    {
+        if (i == aPageNo || (i >= sBegin && i < sEnd))
+            continue;
+        Page* sPage = findPage(i);
+        if (sPage != nullptr && sPage->m_Prefetched)
+        {
+            sPage->m_Prefetched = false;
+            lruPush(*sPage);
+        }
+    }
+    m_ReadaheadPage = aPageNo;
+    m_ReadaheadBegin = sBegin;
+    m_ReadaheadNext = aBackward ? sEnd : sBegin;
+    m_ReadaheadEnd = sEnd;
+    m_ReadaheadBackward = aBackward;
+    m_Cond.notify_all();
+}
+
+template <size_t PAGE_SIZE>
+inline void FileReader<PAGE_SIZE>::readaheadWorker()
+{
+    std::unique_lock<std::mutex> sLock(m_Mutex);
+    while (true)
+    {
+        // Also evicts cached pages to make room for the next one.
+        m_Cond.wait(sLock, [this]
+        {
+            bool sPending = m_ReadaheadBackward ? m_ReadaheadBegin < m_ReadaheadNext : m_ReadaheadNext < m_ReadaheadEnd;
+            return m_ReadaheadStop || (sPending && makeRoom());
+        });
+        if (m_ReadaheadStop)
+            return;
+        size_t sPageNo = m_ReadaheadBackward ? --m_ReadaheadNext : m_ReadaheadNext++;
+        if (findPage(sPageNo) != nullptr)
+            continue;
+
+        Page& sPage = allocPage(sPageNo);
+        sPage.m_Ready = false;
+        sPage.m_Prefetched = true;
+        m_PageBitset.set(sPageNo);
+        ++m_Stats;
+
+        sLock.unlock();
+        bool sSuccess = true;
+        try
+        {
+            readPage(sPage);
+        }
+        catch (const std::exception&)
+        {
+            sSuccess = false;
+        }
+        sLock.lock();
+
+        if (sSuccess)
+        {
+            sPage.m_Ready = true;
+            lruPush(sPage);
+        }
+        else
+        {
+            --m_Stats;
+            m_PageBitset.clear(sPageNo);
+            freePage(sPage);
+        }
+        m_Cond.notify_all();
+    }
+}
+
+// Queues the read of the page, does not submit. Fails if the ring is full.
+template <size_t PAGE_SIZE>
+inline bool FileReader<PAGE_SIZE>::ringRead(Page& aPage)
+{
+    if (!m_Ring.prepareRead(m_Fd, aPage.m_Buffer, aPage.m_Size, aPage.m_PageNo * PAGE_SIZE, aPage.m_PageNo))
+        return false;
+    aPage.m_Ready = false;
+    return true;
+}
+
+// Processes available completions; if aWait, waits for at least one.
+template <size_t PAGE_SIZE>
+inline void FileReader<PAGE_SIZE>::ringComplete(bool aWait)
+{
+    uint64_t sPageNo;
+    int sResult;
+    bool sDone = false;
+    while (true)
+    {
+        while (m_Ring.complete(sPageNo, sResult))
+        {
+            ringCompleted(sPageNo, sResult);
+            sDone = true;
+        }
+        if (sDone || !aWait || m_Ring.inflight() == 0)
+            return;
+        m_Ring.submit(1);
+    }
+}
+
+template <size_t PAGE_SIZE>
+inline void FileReader<PAGE_SIZE>::ringCompleted(size_t aPageNo, int aResult)
+{
+    Page* sFound = findPage(aPageNo);
+    assert(sFound != nullptr);
+    Page& sPage = *sFound;
+    assert(!sPage.m_Ready);
+    if (aResult != static_cast<int>(sPage.m_Size))
+    {
+        // Error or short read, retry synchronously; drop the page on failure.
+        try
+        {
+            readPage(sPage);
+        }
+        catch (const std::exception&)
+        {
+            sPage.m_Ready = true;
+            closePage(sPage);
+            return;
+        }
+    }
+    sPage.m_Ready = true;
+    lruPush(sPage);
 }
 
 // iterator
 template<size_t PAGE_SIZE>
-inline FileReader<PAGE_SIZE>::iterator::iterator(FileReader &aReader, size_t aPos)
+inline FileReader<PAGE_SIZE>::iterator::iterator(FileReader &aReader, size_t aPos, bool aBackward)
     : m_Reader(aReader)
     , m_Pos(std::min(aPos, aReader.m_Size))
-    , m_Page(aReader.bless(aPos < aReader.m_Size ? &aReader.getPage(aPos / PAGE_SIZE) : nullptr))
+    , m_Page(aPos < aReader.m_Size ? aReader.acquire(aPos / PAGE_SIZE, aBackward) : nullptr)
 {
-    assert(m_Pos <= m_Reader.m_Size);
-    assert((m_Page == nullptr) == (m_Pos >= m_Reader.m_Size));
+    assert(valid());
 }
 
+// May be invalidated by reopening, see refresh().
 template<size_t PAGE_SIZE>
 inline FileReader<PAGE_SIZE>::iterator::~iterator()
 {
-    assert(m_Pos <= m_Reader.m_Size);
-    assert((m_Page == nullptr) == (m_Pos >= m_Reader.m_Size));
     m_Reader.curse(m_Page);
 }
 
+// m_Page holds m_Pos. It is missing at the end, and after the file has grown
+// until the iterator is used; in follow mode it stays at the end within the
+// partial last page.
+template<size_t PAGE_SIZE>
+inline bool FileReader<PAGE_SIZE>::iterator::valid() const
+{
+    if (m_Pos > m_Reader.m_Size)
+        return false;
+    if (m_Page == nullptr)
+        return true;
+    return m_Page->m_PageNo == m_Pos / PAGE_SIZE && (m_Pos < m_Reader.m_Size || m_Reader.m_Options.m_Follow);
+}
+
+template<size_t PAGE_SIZE>
+inline typename FileReader<PAGE_SIZE>::Page* FileReader<PAGE_SIZE>::iterator::page() const
+{
+    assert(m_Pos < m_Reader.m_Size);
+    if (m_Page == nullptr)
+        m_Page = m_Reader.acquire(m_Pos / PAGE_SIZE);
+    return m_Page;
+}
+
 template<size_t PAGE_SIZE>
 inline FileReader<PAGE_SIZE>::iterator::iterator(const iterator& a)
     : m_Reader(a.m_Reader)
@@ -252,40 +1230,81 @@ inline typename FileReader<PAGE_SIZE>::iterator& FileReader<PAGE_SIZE>::iterator
 template<size_t PAGE_SIZE>
 inline char FileReader<PAGE_SIZE>::iterator::operator*() const
 {
-    assert(m_Pos <= m_Reader.m_Size);
-    assert((m_Page == nullptr) == (m_Pos >= m_Reader.m_Size));
+    assert(valid());
     if (m_Pos >= m_Reader.m_Size)
         return 0;
-    return m_Page->m_Data[m_Pos % PAGE_SIZE];
+    return page()->m_Data[m_Pos % PAGE_SIZE];
 }
 
 template<size_t PAGE_SIZE>
 inline char FileReader<PAGE_SIZE>::iterator::operator[](size_t aAdvance) const
 {
-    assert(m_Pos <= m_Reader.m_Size);
-    assert((m_Page == nullptr) == (m_Pos >= m_Reader.m_Size));
+    assert(valid());
     if (m_Pos + aAdvance >= m_Reader.m_Size)
         return 0;
     else if (m_Pos / PAGE_SIZE == (m_Pos + aAdvance) / PAGE_SIZE)
-        return m_Page->m_Data[(m_Pos + aAdvance) % PAGE_SIZE];
+        return page()->m_Data[(m_Pos + aAdvance) % PAGE_SIZE];
     else
-        return m_Reader.getPage((m_Pos + aAdvance) / PAGE_SIZE).m_Data[(m_Pos + aAdvance) % PAGE_SIZE];
+        return m_Reader.peek(m_Pos + aAdvance);
 }
 
 template<size_t PAGE_SIZE>
 inline typename FileReader<PAGE_SIZE>::iterator& FileReader<PAGE_SIZE>::iterator::operator++()
 {
-    assert(m_Pos <= m_Reader.m_Size);
-    assert((m_Page == nullptr) == (m_Pos >= m_Reader.m_Size));
-    if (m_Pos == m_Reader.m_Size)
+    assert(valid());
+    if (m_Pos >= m_Reader.m_Size)
         return *this;
     ++m_Pos;
-    if (m_Pos >= m_Reader.m_Size || m_Pos % PAGE_SIZE == 0)
+    if (m_Pos % PAGE_SIZE == 0 || m_Page == nullptr || (m_Pos == m_Reader.m_Size && !m_Reader.m_Options.m_Follow))
+    {
+        Page* sOldPage = m_Page;
+        m_Page = m_Pos < m_Reader.m_Size ? m_Reader.acquire(m_Pos / PAGE_SIZE) : nullptr;
+        m_Reader.curse(sOldPage);
+    }
+    return *this;
+}
+
+template<size_t PAGE_SIZE>
+inline typename FileReader<PAGE_SIZE>::iterator& FileReader<PAGE_SIZE>::iterator::operator--()
+{
+    assert(valid());
+    if (m_Pos == 0)
+        return *this;
+    size_t sPos = m_Pos - 1;
+    if (m_Page == nullptr || m_Page->m_PageNo != sPos / PAGE_SIZE)
     {
         Page* sOldPage = m_Page;
-        m_Page = m_Reader.bless(m_Pos < m_Reader.m_Size ? &m_Reader.getPage(m_Pos / PAGE_SIZE) : nullptr);
+        m_Page = m_Reader.acquire(sPos / PAGE_SIZE, true);
         m_Reader.curse(sOldPage);
     }
+    m_Pos = sPos;
+    return *this;
+}
+
+template<size_t PAGE_SIZE>
+inline std::string_view FileReader<PAGE_SIZE>::iterator::span() const
+{
+    assert(valid());
+    if (m_Pos >= m_Reader.m_Size)
+        return std::string_view();
+    Page* sPage = page();
+    size_t sOffset = m_Pos % PAGE_SIZE;
+    return std::string_view(sPage->m_Data + sOffset, sPage->m_Size - sOffset);
+}
+
+template<size_t PAGE_SIZE>
+inline typename FileReader<PAGE_SIZE>::iterator& FileReader<PAGE_SIZE>::iterator::advance(size_t aCount)
+{
+    assert(valid());
+    size_t sPos = m_Pos + std::min(aCount, m_Reader.m_Size - m_Pos);
+    bool sKeep = sPos < m_Reader.m_Size || m_Reader.m_Options.m_Follow;
+    if (m_Page == nullptr || sPos / PAGE_SIZE != m_Pos / PAGE_SIZE || !sKeep)
+    {
+        Page* sOldPage = m_Page;
+        m_Page = sPos < m_Reader.m_Size ? m_Reader.acquire(sPos / PAGE_SIZE) : nullptr;
+        m_Reader.curse(sOldPage);
+    }
+    m_Pos = sPos;
     return *this;
 }
 
@@ -296,3 +1315,59 @@ inline typename FileReader<PAGE_SIZE>::iterator FileReader<PAGE_SIZE>::iterator:
     ++(*this);
     return sRet;
 }
+
+template<size_t PAGE_SIZE>
+inline typename FileReader<PAGE_SIZE>::iterator FileReader<PAGE_SIZE>::iterator::operator--(int)
+{
+    iterator sRet = *this;
+    --(*this);
+    return sRet;
+}
+
+// reverse_iterator
+template<size_t PAGE_SIZE>
+inline typename FileReader<PAGE_SIZE>::reverse_iterator& FileReader<PAGE_SIZE>::reverse_iterator::operator++()
+{
+    if (m_Itr.m_Pos == 0)
+        m_Itr = m_Itr.m_Reader.end();
+    else
+        --m_Itr;
+    return *this;
+}
+
+template<size_t PAGE_SIZE>
+inline typename FileReader<PAGE_SIZE>::reverse_iterator FileReader<PAGE_SIZE>::reverse_iterator::operator++(int)
+{
+    reverse_iterator sRet = *this;
+    ++(*this);
+    return sRet;
+}
+
+// Stays at the last byte, steps from rend() to the first byte.
+template<size_t PAGE_SIZE>
+inline typename FileReader<PAGE_SIZE>::reverse_iterator& FileReader<PAGE_SIZE>::reverse_iterator::operator--()
+{
+    FileReader& sReader = m_Itr.m_Reader;
+    if (m_Itr.m_Pos == sReader.m_Size)
+        m_Itr = sReader.begin();
+    else if (m_Itr.m_Pos + 1 < sReader.m_Size)
+        ++m_Itr;
+    return *this;
+}
+
+template<size_t PAGE_SIZE>
+inline typename FileReader<PAGE_SIZE>::reverse_iterator FileReader<PAGE_SIZE>::reverse_iterator::operator--(int)
+{
+    reverse_iterator sRet = *this;
+    --(*this);
+    return sRet;
+}
+
+template<size_t PAGE_SIZE>
+inline typename FileReader<PAGE_SIZE>::iterator FileReader<PAGE_SIZE>::reverse_iterator::base() const
+{
+    if (m_Itr.m_Pos == m_Itr.m_Reader.m_Size)
+        return m_Itr.m_Reader.begin();
+    // The page after this one, if any, is taken without turning readahead.
+    return iterator(m_Itr.m_Reader, m_Itr.m_Pos + 1, true);
+}
@@ -0,0 +1,258 @@
+#include <FileReader.hpp>
+#include <FileReaderTestUtils.hpp>
+#include <LineIndex.hpp>
+#include <ParallelFinder.hpp>
+#include <StringFinder.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <thread>
+#include <vector>
+
+const char* filename = "./perf.dat";
+const char* indexname = "./perf.dat.idx";
+const size_t PAGE_SIZE = 64 * 1024;
+
+struct FileRemover
+{
+    ~FileRemover()
+    {
+        remove(indexname);
+        if (remove(filename) != 0)
+            std::cerr << "Failed to remove file!" << std::endl;
+    }
+};
+
+static void checkpoint(const char* aText, size_t aBytes)
+{
+    using namespace std::chrono;
+    high_resolution_clock::time_point now = high_resolution_clock::now();
+    static high_resolution_clock::time_point was;
+    duration<double> time_span = duration_cast<duration<double>>(now - was);
+    if (0 != aBytes)
+    {
+        double MBps = aBytes / 1024. / 1024. / time_span.count();
+        std::cout << aText << ":\t" << MBps << " MB/s" << std::endl;
+    }
+    was = now;
+}
+
+void run(const char* aName, const FileReader<PAGE_SIZE>::Options& aOptions)
+{
+    size_t sum = 0;
+    checkpoint("", 0);
+    FileReader<PAGE_SIZE> fr(filename, aOptions);
+    size_t sSize = fr.end().pos();
+    auto sEnd = fr.end();
+    for (auto sItr = fr.begin(); sItr != sEnd; ++sItr)
+        sum += static_cast<unsigned char>(*sItr);
+    checkpoint(aName, sSize);
+    std::cout << "Check: " << sum << std::endl;
+}
+
+void runReverse(const char* aName, const FileReader<PAGE_SIZE>::Options& aOptions)
+{
+    size_t sum = 0;
+    checkpoint("", 0);
+    FileReader<PAGE_SIZE> fr(filename, aOptions);
+    size_t sSize = fr.end().pos();
+    auto sEnd = fr.rend();
+    for (auto sItr = fr.rbegin(); sItr != sEnd; ++sItr)
+        sum += static_cast<unsigned char>(*sItr);
+    checkpoint(aName, sSize);
+    std::cout << "Check: " << sum << std::endl;
+}
+
+// The last lines of the log: the cost must not depend on the file size.
+void runTail(size_t aLines)
+{
+    FileReader<PAGE_SIZE> fr(filename);
+    size_t sLines = 0;
+    checkpoint("", 0);
+    auto sItr = fr.rbegin();
+    for (auto sEnd = fr.rend(); sItr != sEnd && sLines <= aLines; ++sItr)
+        sLines += *sItr == '\n';
+    size_t sBytes = fr.end().pos() - sItr.pos();
+    checkpoint("tail   ", sBytes);
+    std::cout << "Tail: " << aLines << " lines, " << sBytes << " bytes, "
+              << fr.getStats().m_PagesTotalRead << " pages read" << std::endl;
+}
+
+// Byte iterator vs span on the same kernels: newline count and needle search.
+void runKernels()
+{
+    const char* sNeedle = "banned timeout";
+    FileReader<PAGE_SIZE> fr(filename);
+    size_t sSize = fr.end().pos();
+    auto sEnd = fr.end();
+    size_t sum = 0;
+
+    checkpoint("", 0);
+    for (auto sItr = fr.begin(); sItr != sEnd; ++sItr)
+        sum += *sItr == '\n';
+    checkpoint("lines byte", sSize);
+    std::cout << "Check: " << sum << std::endl;
+
+    sum = 0;
+    checkpoint("", 0);
+    for (auto sItr = fr.begin(); sItr != sEnd; )
+    {
+        std::string_view sSpan = sItr.span();
+        sum += std::count(sSpan.begin(), sSpan.end(), '\n');
+        sItr.advance(sSpan.size());
+    }
+    checkpoint("lines span", sSize);
+    std::cout << "Check: " << sum << std::endl;
+
+    StringFinder<uint8_t> sFinder(sNeedle);
+    sum = 0;
+    checkpoint("", 0);
+    for (auto sItr = fr.begin(); sItr != sEnd; ++sItr)
+        sum += sFinder.feed(*sItr);
+    checkpoint("find byte", sSize);
+    std::cout << "Check: " << sum << std::endl;
+
+    sFinder.restart();
+    sum = 0;
+    checkpoint("", 0);
+    for (auto sItr = fr.begin(); sItr != sEnd; )
+    {
+        std::string_view sSpan = sItr.span();
+        for (char c : sSpan)
+            sum += sFinder.feed(c);
+        sItr.advance(sSpan.size());
+    }
+    checkpoint("find span", sSize);
+    std::cout << "Check: " << sum << std::endl;
+
+    sFinder.restart();
+    sum = 0;
+    std::vector<size_t> sEnds;
+    checkpoint("", 0);
+    for (auto sItr = fr.begin(); sItr != sEnd; )
+    {
+        std::string_view sSpan = sItr.span();
+        sEnds.clear();
+        sFinder.feed(sSpan.data(), sSpan.data() + sSpan.size(), std::back_inserter(sEnds));
+        sum += sEnds.size();
+        sItr.advance(sSpan.size());
+    }
+    checkpoint("find bulk", sSize);
+    std::cout << "Check: " << sum << std::endl;
+}
+
+// ParallelFinder from one thread up to twice the hardware threads.
+void runParallel(const FileReader<PAGE_SIZE>::Options& aOptions)
+{
+    ParallelFinder<PAGE_SIZE, uint8_t> sFinder("banned timeout");
+    FileReader<PAGE_SIZE> fr(filename);
+    size_t sSize = fr.end().pos();
+    size_t sMax = 2 * std::max(1u, std::thread::hardware_concurrency());
+    for (size_t sThreads = 1; sThreads <= sMax; sThreads *= 2)
+    {
+        checkpoint("", 0);
+        size_t sCount = sFinder.find(filename, sThreads, aOptions).size();
+        std::string sName = "threads " + std::to_string(sThreads);
+        checkpoint(sName.c_str(), sSize);
+        std::cout << "Check: " << sCount << std::endl;
+    }
+}
+
+// Line index: built, reloaded from the sidecar, and random "line N" and
+// "line at offset" lookups vs counting newlines from the start.
+void runLineIndex(size_t aStep)
+{
+    std::cout << "Line index step: " << aStep << std::endl;
+    remove(indexname);
+    FileReader<PAGE_SIZE>::Options sOptions;
+    sOptions.m_Source = FileReader<PAGE_SIZE>::Source::MMAP;
+    FileReader<PAGE_SIZE> fr(filename, sOptions);
+    size_t sSize = fr.end().pos();
+    checkpoint("", 0);
+    {
+        LineIndex<PAGE_SIZE> sIndex(aStep, indexname);
+        sIndex.update(fr);
+        checkpoint("index build", sSize);
+        std::cout << "Lines: " << sIndex.lines() << ", index: " << sIndex.memory() << " bytes" << std::endl;
+    }
+
+    auto sStart = std::chrono::high_resolution_clock::now();
+    LineIndex<PAGE_SIZE> sIndex(aStep, indexname);
+    sIndex.update(fr);
+    std::cout << "index load:\t" << std::chrono::duration<double, std::micro>(std::chrono::high_resolution_clock::now() - sStart).count()
+              << " us" << std::endl;
+
+    const size_t QUERIES = 100000;
+    size_t sum = 0;
+    sStart = std::chrono::high_resolution_clock::now();
+    for (size_t i = 0; i < QUERIES; i++)
+    {
+        sum += sIndex.lineOffset(fr, (static_cast<size_t>(rand()) << 16 ^ rand()) % sIndex.lines());
+        sum += sIndex.lineAt(fr, (static_cast<size_t>(rand()) << 16 ^ rand()) % sSize).first;
+    }
+    std::cout << "index lookup:\t" << std::chrono::duration<double, std::micro>(std::chrono::high_resolution_clock::now() - sStart).count() / QUERIES / 2
+              << " us" << std::endl;
+    std::cout << "Check: " << sum << std::endl;
+
+    // Without the index: the newlines before a random offset.
+    sum = 0;
+    sStart = std::chrono::high_resolution_clock::now();
+    const size_t SCANS = 4;
+    for (size_t i = 0; i < SCANS; i++)
+    {
+        size_t sOffset = (static_cast<size_t>(rand()) << 16 ^ rand()) % sSize;
+        for (auto sItr = fr.begin(); sItr.pos() < sOffset; )
+        {
+            std::string_view sSpan = sItr.span().substr(0, sOffset - sItr.pos());
+            sum += std::count(sSpan.begin(), sSpan.end(), '\n');
+            sItr.advance(sSpan.size());
+        }
+    }
+    std::cout << "scan lookup:\t" << std::chrono::duration<double, std::micro>(std::chrono::high_resolution_clock::now() - sStart).count() / SCANS
+              << " us" << std::endl;
+    std::cout << "Check: " << sum << std::endl;
+    std::cout << std::endl;
+}
+
+int main(int argc, char** argv)
+{
+    // File size in MB, the page cache is expected to be warm after generation.
+    size_t sSizeMB = argc > 1 ? atoll(argv[1]) : 512;
+    generateLog(filename, sSizeMB * 1024 * 1024);
+    FileRemover sRemover;
+
+    FileReader<PAGE_SIZE>::Options sOptions;
+    sOptions.m_Source = FileReader<PAGE_SIZE>::Source::READ;
+    run("read   ", sOptions);
+    sOptions.m_Source = FileReader<PAGE_SIZE>::Source::MMAP;
+    run("mmap   ", sOptions);
+    sOptions.m_Source = FileReader<PAGE_SIZE>::Source::IO_URING;
+    run("uring  ", sOptions);
+
+    sOptions.m_ReadaheadPages = 8;
+    sOptions.m_Source = FileReader<PAGE_SIZE>::Source::READ;
+    run("read+ra", sOptions);
+    sOptions.m_Source = FileReader<PAGE_SIZE>::Source::MMAP;
+    run("mmap+ra", sOptions);
+    sOptions.m_Source = FileReader<PAGE_SIZE>::Source::IO_URING;
+    run("uring+ra", sOptions);
+
+    sOptions.m_Source = FileReader<PAGE_SIZE>::Source::READ;
+    runReverse("rread+ra", sOptions);
+    sOptions.m_Source = FileReader<PAGE_SIZE>::Source::MMAP;
+    runReverse("rmmap+ra", sOptions);
+    sOptions.m_Source = FileReader<PAGE_SIZE>::Source::IO_URING;
+    runReverse("ruring+ra", sOptions);
+    runTail(1000);
+
+    runKernels();
+    for (size_t sStep : {64, 1024})
+        runLineIndex(sStep);
+
+    sOptions.m_Source = FileReader<PAGE_SIZE>::Source::MMAP;
+    runParallel(sOptions);
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// Words of generated log messages, pairs of them make realistic needles.
+inline const std::vector<std::string>& logWords()
+{
+    static const std::vector<std::string> sWords = {"request", "accepted", "session", "closed", "user", "banned",
+                                                    "timeout", "retry", "client", "upstream", "cache", "miss"};
+    return sWords;
+}
+
+// Appends a line that looks like a service log: timestamp, level, a few
+// keys with random values.
+inline void appendLogLine(std::string& aBuf, size_t aLine)
+{
+    static const char* sLevels[] = {"DEBUG", "INFO", "INFO", "INFO", "WARN", "ERROR"};
+    const std::vector<std::string>& sWords = logWords();
+    char sLineBuf[256];
+    int sLen = snprintf(sLineBuf, sizeof(sLineBuf), "2020-02-%02zu %02zu:%02zu:%02zu.%03zu [%s] bannerd: %s %s id=%u ip=%u.%u.%u.%u %s\n",
+                        1 + aLine / 8640000 % 28, aLine / 360000 % 24, aLine / 6000 % 60, aLine / 100 % 60, aLine % 100 * 10,
+                        sLevels[rand() % 6], sWords[rand() % 12].c_str(), sWords[rand() % 12].c_str(), rand() % 1000000,
+                        rand() % 256, rand() % 256, rand() % 256, rand() % 256, sWords[rand() % 12].c_str());
+    aBuf.append(sLineBuf, sLen);
+}
+
+// Approximately (up to one line more) aSize bytes of log text.
+inline std::string generateLogText(size_t aSize)
+{
+    std::string sBuf;
+    sBuf.reserve(aSize + 256);
+    for (size_t sLine = 0; sBuf.size() < aSize; ++sLine)
+        appendLogLine(sBuf, sLine);
+    return sBuf;
+}
+
+// Writes approximately (up to one line more) aSize bytes of log text.
+inline void generateLog(const char* aFileName, size_t aSize)
+{
+    std::ofstream f(aFileName, std::fstream::out | std::fstream::trunc | std::fstream::binary);
+    if (!f)
+        throw std::runtime_error("Failed to create file");
+    std::string sBuf;
+    size_t sWritten = 0;
+    size_t sLine = 0;
+    while (sWritten < aSize)
+    {
+        size_t sWas = sBuf.size();
+        appendLogLine(sBuf, sLine);
+        sWritten += sBuf.size() - sWas;
+        ++sLine;
+        if (sBuf.size() >= 1024 * 1024)
+        {
+            f.write(sBuf.data(), sBuf.size());
+            sBuf.clear();
+        }
+    }
+    f.write(sBuf.data(), sBuf.size());
+    if (!f)
+        throw std::runtime_error("Failed to write file");
+}
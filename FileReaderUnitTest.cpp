@@ -1,11 +1,41 @@
 #include <FileReader.hpp>
 
+#include <atomic>
+#include <cstddef>
 #include <cstdio>
+#include <cstdlib>
 #include <iostream>
 #include <fstream>
+#include <new>
 
 const char* filename = "./test.dat";
 
+std::atomic<size_t> allocations{0};
+
+// Counts heap allocations. The whole set of new and delete is replaced, so
+// every block is released by the function of the same family.
+static void* allocate(size_t aSize, size_t aAlign = alignof(std::max_align_t))
+{
+    ++allocations;
+    aSize = aSize != 0 ? aSize : 1;
+    if (void* p = aligned_alloc(aAlign, (aSize + aAlign - 1) / aAlign * aAlign))
+        return p;
+    throw std::bad_alloc();
+}
+
+void* operator new(size_t aSize) { return allocate(aSize); }
+void* operator new[](size_t aSize) { return allocate(aSize); }
+void* operator new(size_t aSize, std::align_val_t aAlign) { return allocate(aSize, static_cast<size_t>(aAlign)); }
+void* operator new[](size_t aSize, std::align_val_t aAlign) { return allocate(aSize, static_cast<size_t>(aAlign)); }
+void operator delete(void* p) noexcept { free(p); }
+void operator delete[](void* p) noexcept { free(p); }
+void operator delete(void* p, size_t) noexcept { free(p); }
+void operator delete[](void* p, size_t) noexcept { free(p); }
+void operator delete(void* p, std::align_val_t) noexcept { free(p); }
+void operator delete[](void* p, std::align_val_t) noexcept { free(p); }
+void operator delete(void* p, size_t, std::align_val_t) noexcept { free(p); }
+void operator delete[](void* p, size_t, std::align_val_t) noexcept { free(p); }
+
 void check(bool aExpession, const char* aMessage)
 {
     if (!aExpession)
@@ -27,9 +57,9 @@ struct FileRemover
 };
 
 template <size_t FILE_SIZE, size_t PAGE_SIZE>
-void test1(const char* aData)
+void test1(const char* aData, const typename FileReader<PAGE_SIZE>::Options& aOptions)
 {
-    FileReader<PAGE_SIZE> fr(filename);
+    FileReader<PAGE_SIZE> fr(filename, aOptions);
     {
         auto sItr = fr.begin();
         if (FILE_SIZE == 0)
@@ -49,9 +79,9 @@ void test1(const char* aData)
 }
 
 template <size_t FILE_SIZE, size_t PAGE_SIZE>
-void test2(const char* aData)
+void test2(const char* aData, const typename FileReader<PAGE_SIZE>::Options& aOptions)
 {
-    FileReader<PAGE_SIZE> fr(filename);
+    FileReader<PAGE_SIZE> fr(filename, aOptions);
     auto sItr = fr.begin();
     for (size_t i = 0; i < FILE_SIZE; ++i, ++sItr)
     {
@@ -69,9 +99,9 @@ void test2(const char* aData)
 }
 
 template <size_t FILE_SIZE, size_t PAGE_SIZE>
-void test3(const char* aData)
+void test3(const char* aData, const typename FileReader<PAGE_SIZE>::Options& aOptions)
 {
-    FileReader<PAGE_SIZE> fr(filename);
+    FileReader<PAGE_SIZE> fr(filename, aOptions);
     auto sItr = fr.begin();
     for (size_t i = 0; i < FILE_SIZE; ++i, ++sItr)
     {
@@ -89,9 +119,9 @@ void test3(const char* aData)
 }
 
 template <size_t FILE_SIZE, size_t PAGE_SIZE>
-void test4(const char* aData)
+void test4(const char* aData, const typename FileReader<PAGE_SIZE>::Options& aOptions)
 {
-    FileReader<PAGE_SIZE> fr(filename);
+    FileReader<PAGE_SIZE> fr(filename, aOptions);
     auto sItr = fr.begin();
     auto sItr2 = sItr;
     for (size_t i = 0; i < FILE_SIZE; ++i, ++sItr)
@@ -107,9 +137,9 @@ void test4(const char* aData)
 }
 
 template <size_t FILE_SIZE, size_t PAGE_SIZE>
-void test5(const char* aData)
+void test5(const char* aData, const typename FileReader<PAGE_SIZE>::Options& aOptions)
 {
-    FileReader<PAGE_SIZE> fr(filename);
+    FileReader<PAGE_SIZE> fr(filename, aOptions);
     auto sItr = fr.begin();
     auto sItr2 = fr.begin();
     for (size_t i = 0; i < FILE_SIZE; ++i, ++sItr)
@@ -134,9 +164,9 @@ void test5(const char* aData)
 }
 
 template <size_t FILE_SIZE, size_t PAGE_SIZE>
-void test6(const char* aData)
+void test6(const char* aData, const typename FileReader<PAGE_SIZE>::Options& aOptions)
 {
-    FileReader<PAGE_SIZE> fr(filename);
+    FileReader<PAGE_SIZE> fr(filename, aOptions);
     auto sItr = fr.begin();
     for (size_t i = 0; i < FILE_SIZE; ++i, ++sItr)
     {
@@ -157,9 +187,9 @@ void test6(const char* aData)
 }
 
 template <size_t FILE_SIZE, size_t PAGE_SIZE>
-void test7(const char* aData)
+void test7(const char* aData, const typename FileReader<PAGE_SIZE>::Options& aOptions)
 {
-    FileReader<PAGE_SIZE> fr(filename);
+    FileReader<PAGE_SIZE> fr(filename, aOptions);
     auto sItr = fr.begin();
     for (size_t i = 0; i < FILE_SIZE; ++i, ++sItr)
     {
@@ -177,6 +207,342 @@ void test7(const char* aData)
     CHECK(fr.getStats().m_PagesTotalRead == (FILE_SIZE + PAGE_SIZE - 1) / PAGE_SIZE);
 }
 
+template <size_t FILE_SIZE, size_t PAGE_SIZE>
+void test8(const char* aData, typename FileReader<PAGE_SIZE>::Options aOptions)
+{
+    const size_t READAHEAD = 3;
+    const size_t PAGES = (FILE_SIZE + PAGE_SIZE - 1) / PAGE_SIZE;
+    aOptions.m_ReadaheadPages = READAHEAD;
+    FileReader<PAGE_SIZE> fr(filename, aOptions);
+    {
+        auto sItr = fr.begin();
+        for (size_t i = 0; i < FILE_SIZE; ++i, ++sItr)
+        {
+            CHECK(sItr != fr.end());
+            CHECK(aData[i] == *sItr);
+            if (i + 1 < FILE_SIZE)
+                CHECK(aData[i + 1] == sItr[1]);
+        }
+        CHECK(sItr == fr.end());
+    }
+    CHECK(fr.getStats().m_PagesCount == 0);
+    CHECK(fr.getStats().m_PagesMaxCount <= 2 + READAHEAD);
+    CHECK(fr.getStats().m_PagesTotalRead == PAGES);
+    if (aOptions.m_Source == FileReader<PAGE_SIZE>::Source::READ)
+        CHECK(fr.getStats().m_ReadaheadHits + fr.getStats().m_ReadaheadMisses == PAGES);
+}
+
+template <size_t FILE_SIZE, size_t PAGE_SIZE>
+void test9(const char* aData, typename FileReader<PAGE_SIZE>::Options aOptions)
+{
+    for (size_t sReadahead : {0, 3})
+    {
+        aOptions.m_ReadaheadPages = sReadahead;
+        FileReader<PAGE_SIZE> fr(filename, aOptions);
+        auto sItr = fr.begin();
+        auto sEnd = fr.end();
+        size_t sAllocations = allocations;
+        size_t sPoolAllocations = fr.getStats().m_PoolAllocations;
+        for (size_t i = 0; i < FILE_SIZE; ++i, ++sItr)
+        {
+            CHECK(aData[i] == *sItr);
+            if (i + 1 < FILE_SIZE)
+                CHECK(aData[i + 1] == sItr[1]);
+        }
+        CHECK(sItr == sEnd);
+        CHECK(allocations == sAllocations);
+        CHECK(fr.getStats().m_PoolAllocations == sPoolAllocations);
+        CHECK(fr.getStats().m_PoolCapacity == (FILE_SIZE ? sReadahead + 4 : 0));
+    }
+}
+
+template <size_t FILE_SIZE, size_t PAGE_SIZE>
+void test10(const char* aData, typename FileReader<PAGE_SIZE>::Options aOptions)
+{
+    const size_t CACHE = 4;
+    const size_t PAGES = (FILE_SIZE + PAGE_SIZE - 1) / PAGE_SIZE;
+    for (size_t sReadahead : {0, 2})
+    {
+        aOptions.m_ReadaheadPages = sReadahead;
+        aOptions.m_CachePages = CACHE;
+        FileReader<PAGE_SIZE> fr(filename, aOptions);
+        // Look back at the previous page (context lines) on every step.
+        for (size_t i = 0; i < FILE_SIZE; i += PAGE_SIZE / 2)
+        {
+            auto sItr = fr.at(i);
+            CHECK(aData[i] == *sItr);
+            if (i >= PAGE_SIZE)
+            {
+                auto sBack = fr.at(i - PAGE_SIZE);
+                CHECK(aData[i - PAGE_SIZE] == *sBack);
+                if (i + 1 < FILE_SIZE)
+                    CHECK(aData[i + 1] == sBack[PAGE_SIZE + 1]);
+            }
+        }
+        const auto& sStats = fr.getStats();
+        CHECK(sStats.m_PagesCount <= CACHE);
+        CHECK(sStats.m_PagesTotalRead == PAGES);
+        CHECK(sStats.m_CacheEvictions == sStats.m_PagesTotalRead - sStats.m_PagesCount);
+        if (sReadahead == 0)
+            CHECK(sStats.m_CacheMisses == PAGES);
+        if (PAGES > 1)
+            CHECK(sStats.m_CacheHits != 0);
+    }
+}
+
+template <size_t FILE_SIZE, size_t PAGE_SIZE>
+void test11(const char* aData, const typename FileReader<PAGE_SIZE>::Options& aOptions)
+{
+    FileReader<PAGE_SIZE> fr(filename, aOptions);
+    {
+        std::string sCollected;
+        auto sItr = fr.begin();
+        while (sItr != fr.end())
+        {
+            std::string_view sSpan = sItr.span();
+            CHECK(!sSpan.empty());
+            CHECK(sSpan.size() <= PAGE_SIZE);
+            CHECK((sItr.pos() + sSpan.size()) % PAGE_SIZE == 0 || sItr.pos() + sSpan.size() == FILE_SIZE);
+            sCollected.append(sSpan);
+            sItr.advance(sSpan.size());
+            CHECK(fr.getStats().m_PagesCount <= 1);
+        }
+        CHECK(sItr.span().empty());
+        CHECK(sCollected == std::string_view(aData, FILE_SIZE));
+    }
+    for (size_t sStep : {size_t(1), size_t(3), PAGE_SIZE, PAGE_SIZE + 1, 3 * PAGE_SIZE - 1})
+    {
+        auto sItr = fr.begin();
+        for (size_t i = 0; i < FILE_SIZE; i += sStep, sItr.advance(sStep))
+        {
+            CHECK(sItr.pos() == i);
+            CHECK(aData[i] == *sItr);
+            CHECK(aData[i] == sItr.span()[0]);
+        }
+        CHECK(sItr == fr.end());
+        sItr.advance(sStep);
+        CHECK(sItr == fr.end());
+    }
+    CHECK(fr.getStats().m_PagesCount == 0);
+    CHECK(fr.getStats().m_PagesMaxCount <= 2);
+}
+
+template <size_t FILE_SIZE, size_t PAGE_SIZE>
+void test12(const char* aData, typename FileReader<PAGE_SIZE>::Options aOptions)
+{
+    const size_t PAGES = (FILE_SIZE + PAGE_SIZE - 1) / PAGE_SIZE;
+    for (size_t sReadahead : {0, 3})
+    {
+        aOptions.m_ReadaheadPages = sReadahead;
+        {
+            FileReader<PAGE_SIZE> fr(filename, aOptions);
+            {
+                auto sItr = fr.end();
+                for (size_t i = FILE_SIZE; i > 0; --i)
+                {
+                    --sItr;
+                    CHECK(sItr.pos() == i - 1);
+                    CHECK(aData[i - 1] == *sItr);
+                }
+                CHECK(sItr.pos() == 0);
+                --sItr;
+                CHECK(sItr.pos() == 0);
+                CHECK(fr.getStats().m_PagesCount <= 1 + sReadahead);
+            }
+            CHECK(fr.getStats().m_PagesCount == 0);
+            CHECK(fr.getStats().m_PagesMaxCount <= 2 + sReadahead);
+            CHECK(fr.getStats().m_PagesTotalRead == PAGES);
+            if (sReadahead != 0 && aOptions.m_Source == FileReader<PAGE_SIZE>::Source::READ)
+                CHECK(fr.getStats().m_ReadaheadHits + fr.getStats().m_ReadaheadMisses == PAGES);
+        }
+        {
+            // The last bytes cost only the last pages.
+            FileReader<PAGE_SIZE> fr(filename, aOptions);
+            const size_t TAIL = std::min(FILE_SIZE, PAGE_SIZE + 1);
+            size_t i = FILE_SIZE;
+            for (auto sItr = fr.rbegin(); sItr != fr.rend() && i > FILE_SIZE - TAIL; ++sItr, --i)
+                CHECK(aData[i - 1] == *sItr);
+            CHECK(i == FILE_SIZE - TAIL);
+            // Only the readahead window ahead of the scan stays.
+            CHECK(fr.getStats().m_PagesCount <= sReadahead);
+            // The last step lands on the page before the tail.
+            CHECK(fr.getStats().m_PagesTotalRead <= std::min(PAGES, 3 + sReadahead));
+        }
+        {
+            FileReader<PAGE_SIZE> fr(filename, aOptions);
+            std::string sCollected;
+            for (auto sItr = fr.rbegin(); sItr != fr.rend(); ++sItr)
+            {
+                CHECK(sItr.pos() == FILE_SIZE - 1 - sCollected.size());
+                CHECK(sItr.base().pos() == sItr.pos() + 1);
+                sCollected.push_back(*sItr);
+            }
+            CHECK(sCollected == std::string(std::string_view(aData, FILE_SIZE).rbegin(), std::string_view(aData, FILE_SIZE).rend()));
+            // Each base() at the page end reads the next page once more.
+            CHECK(fr.getStats().m_PagesTotalRead <= 2 * PAGES);
+            CHECK(fr.rend().base() == fr.begin());
+            CHECK((--fr.rend()).pos() == 0);
+            // Back and forth across page borders.
+            auto sItr = fr.at(FILE_SIZE / 2);
+            for (size_t sStep = 0; sStep < 3 * PAGE_SIZE && FILE_SIZE != 0; sStep++)
+            {
+                size_t sPos = sItr.pos();
+                if (sPos > 0)
+                {
+                    CHECK(aData[sPos] == *(sItr--));
+                    CHECK(aData[sPos - 1] == *sItr);
+                    CHECK(aData[sPos] == *(++sItr));
+                }
+                if (sStep % 2 == 0 && sPos > 0)
+                    --sItr;
+                else if (sPos + 1 < FILE_SIZE)
+                    ++sItr;
+            }
+        }
+    }
+}
+
+void writeFile(const char* aFileName, const char* aData, size_t aSize, bool aAppend)
+{
+    std::ofstream f(aFileName, std::fstream::out | (aAppend ? std::fstream::app : std::fstream::trunc) | std::fstream::binary);
+    f.write(aData, aSize);
+}
+
+template <size_t FILE_SIZE, size_t PAGE_SIZE>
+void test13(const char* aData, typename FileReader<PAGE_SIZE>::Options aOptions)
+{
+    using Change = typename FileReader<PAGE_SIZE>::Change;
+    const char* sFollowName = "./follow.dat";
+    const char* sRotatedName = "./follow.dat.1";
+    const size_t PAGES = (FILE_SIZE + PAGE_SIZE - 1) / PAGE_SIZE;
+    aOptions.m_Follow = true;
+    for (size_t sReadahead : {0, 3})
+    {
+        aOptions.m_ReadaheadPages = sReadahead;
+        size_t sWritten = FILE_SIZE / 3;
+        writeFile(sFollowName, aData, sWritten, false);
+        {
+            FileReader<PAGE_SIZE> fr(sFollowName, aOptions);
+            CHECK(fr.wait(1) == Change::NONE);
+            std::string sCollected;
+            auto sItr = fr.begin();
+            size_t sChunk = 1;
+            while (true)
+            {
+                // Bytes and spans in turn.
+                for (bool sSpan = false; sItr != fr.end(); sSpan = !sSpan)
+                {
+                    if (sSpan)
+                    {
+                        sCollected.append(sItr.span());
+                        sItr.advance(sItr.span().size());
+                    }
+                    else
+                    {
+                        sCollected.push_back(*sItr++);
+                    }
+                }
+                CHECK(sCollected == std::string_view(aData, sWritten));
+                if (sWritten == FILE_SIZE)
+                    break;
+                size_t sSize = std::min(sChunk, FILE_SIZE - sWritten);
+                writeFile(sFollowName, aData + sWritten, sSize, true);
+                sWritten += sSize;
+                sChunk = sChunk * 3 + 1;
+                CHECK(fr.wait(1000) == Change::GREW);
+            }
+            CHECK(fr.getStats().m_PagesTotalRead == PAGES);
+
+            // Truncation: iterators of the old file may only be dropped.
+            auto sMiddle = fr.at(FILE_SIZE / 2);
+            writeFile(sFollowName, aData, FILE_SIZE / 4, false);
+            CHECK(fr.refresh() == (FILE_SIZE / 4 < FILE_SIZE ? Change::REOPENED : Change::NONE));
+            sItr = fr.begin();
+            sCollected.clear();
+            for (; sItr != fr.end(); ++sItr)
+                sCollected.push_back(*sItr);
+            CHECK(sCollected == std::string_view(aData, FILE_SIZE / 4));
+            sMiddle = fr.end();
+
+            // Rotation: the rest of the old file comes first.
+            if (rename(sFollowName, sRotatedName) != 0)
+                throw std::runtime_error("Failed to rename file");
+            writeFile(sFollowName, aData, FILE_SIZE, false);
+            writeFile(sRotatedName, "tail", 4, true);
+            CHECK(fr.wait(1000) == Change::GREW);
+            sCollected.clear();
+            for (; sItr != fr.end(); ++sItr)
+                sCollected.push_back(*sItr);
+            CHECK(sCollected == "tail");
+            CHECK(fr.wait(1000) == Change::REOPENED);
+            sCollected.clear();
+            for (sItr = fr.begin(); sItr != fr.end(); ++sItr)
+                sCollected.push_back(*sItr);
+            CHECK(sCollected == std::string_view(aData, FILE_SIZE));
+            CHECK(fr.getStats().m_Reopens == (FILE_SIZE / 4 < FILE_SIZE ? 2 : 1));
+        }
+        remove(sFollowName);
+        remove(sRotatedName);
+    }
+}
+
+// A tail scan that waits for readahead on every page: readahead runs
+// backward from the first page read, so every page after it is a hit.
+template <size_t FILE_SIZE, size_t PAGE_SIZE>
+void test14(const char* aData, typename FileReader<PAGE_SIZE>::Options aOptions)
+{
+    const size_t PAGES = (FILE_SIZE + PAGE_SIZE - 1) / PAGE_SIZE;
+    const size_t TAIL_PAGES = 5;
+    if (aOptions.m_Source != FileReader<PAGE_SIZE>::Source::READ || PAGES <= TAIL_PAGES)
+        return;
+    aOptions.m_ReadaheadPages = 3;
+    FileReader<PAGE_SIZE> fr(filename, aOptions);
+    size_t sPages = 0;
+    for (auto sItr = fr.rbegin(); sItr != fr.rend(); ++sItr)
+    {
+        CHECK(aData[sItr.pos()] == *sItr);
+        if (sItr.pos() % PAGE_SIZE != 0)
+            continue;
+        if (++sPages == TAIL_PAGES)
+            break;
+        fr.waitReadahead();
+    }
+    CHECK(fr.getStats().m_ReadaheadMisses == 1);
+    CHECK(fr.getStats().m_ReadaheadHits == TAIL_PAGES - 1);
+}
+
+// A forward scan to the middle, then back: readahead turns with the scan
+// at once, so every page back after the first one is a hit.
+template <size_t FILE_SIZE, size_t PAGE_SIZE>
+void test15(const char* aData, typename FileReader<PAGE_SIZE>::Options aOptions)
+{
+    const size_t PAGES = (FILE_SIZE + PAGE_SIZE - 1) / PAGE_SIZE;
+    const size_t BACK_PAGES = 5;
+    if (aOptions.m_Source != FileReader<PAGE_SIZE>::Source::READ || PAGES <= 2 * BACK_PAGES)
+        return;
+    aOptions.m_ReadaheadPages = 3;
+    FileReader<PAGE_SIZE> fr(filename, aOptions);
+    auto sItr = fr.begin();
+    for (size_t i = 0; i < PAGES / 2 * PAGE_SIZE; ++i, ++sItr)
+    {
+        CHECK(aData[i] == *sItr);
+        if (sItr.pos() % PAGE_SIZE == 0)
+            fr.waitReadahead();
+    }
+    size_t sHits = fr.getStats().m_ReadaheadHits;
+    size_t sMisses = fr.getStats().m_ReadaheadMisses;
+    for (size_t i = 0; i < BACK_PAGES * PAGE_SIZE; ++i)
+    {
+        --sItr;
+        CHECK(aData[sItr.pos()] == *sItr);
+        if (sItr.pos() % PAGE_SIZE == PAGE_SIZE - 1)
+            fr.waitReadahead();
+    }
+    // The first page back is left by the scan, it may be still there.
+    CHECK(fr.getStats().m_ReadaheadMisses - sMisses <= 1);
+    CHECK(fr.getStats().m_ReadaheadHits - sHits == BACK_PAGES - 1);
+}
+
 template <size_t FILE_SIZE, size_t PAGE_SIZE>
 void test()
 {
@@ -188,13 +554,27 @@ void test()
     f.close();
     FileRemover fr;
 
-    test1<FILE_SIZE, PAGE_SIZE>(sData);
-    test2<FILE_SIZE, PAGE_SIZE>(sData);
-    test3<FILE_SIZE, PAGE_SIZE>(sData);
-    test4<FILE_SIZE, PAGE_SIZE>(sData);
-    test5<FILE_SIZE, PAGE_SIZE>(sData);
-    test6<FILE_SIZE, PAGE_SIZE>(sData);
-    test7<FILE_SIZE, PAGE_SIZE>(sData);
+    using Source = typename FileReader<PAGE_SIZE>::Source;
+    for (Source sSource : {Source::READ, Source::MMAP, Source::IO_URING})
+    {
+        typename FileReader<PAGE_SIZE>::Options sOptions;
+        sOptions.m_Source = sSource;
+        test1<FILE_SIZE, PAGE_SIZE>(sData, sOptions);
+        test2<FILE_SIZE, PAGE_SIZE>(sData, sOptions);
+        test3<FILE_SIZE, PAGE_SIZE>(sData, sOptions);
+        test4<FILE_SIZE, PAGE_SIZE>(sData, sOptions);
+        test5<FILE_SIZE, PAGE_SIZE>(sData, sOptions);
+        test6<FILE_SIZE, PAGE_SIZE>(sData, sOptions);
+        test7<FILE_SIZE, PAGE_SIZE>(sData, sOptions);
+        test8<FILE_SIZE, PAGE_SIZE>(sData, sOptions);
+        test9<FILE_SIZE, PAGE_SIZE>(sData, sOptions);
+        test10<FILE_SIZE, PAGE_SIZE>(sData, sOptions);
+        test11<FILE_SIZE, PAGE_SIZE>(sData, sOptions);
+        test12<FILE_SIZE, PAGE_SIZE>(sData, sOptions);
+        test13<FILE_SIZE, PAGE_SIZE>(sData, sOptions);
+        test14<FILE_SIZE, PAGE_SIZE>(sData, sOptions);
+        test15<FILE_SIZE, PAGE_SIZE>(sData, sOptions);
+    }
 }
 
 int main()
@@ -214,6 +594,7 @@ int main()
         test<999, 8>();
         test<1000, 8>();
         test<1001, 8>();
+        test<4097, 4096>();
     }
     catch (const std::exception& e)
     {
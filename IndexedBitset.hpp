@@ -1,44 +1,93 @@
 #pragma once
 
+#include <algorithm>
+#include <array>
+#include <atomic>
 #include <cassert>
 #include <cstddef>
 #include <cstdint>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <utility>
 #include <vector>
 
-class IndexedBitset
+// Set of bits with summary layers: a bit of layer i + 1 is set if the word
+// of layer i under it is not empty, the top layer is one word. The storage of
+// the layers is DERIVED's: layerCount() (0 for no bits), layerSize(i) in
+// words and layer(i), the words of layer i, layer 0 being the bits.
+template <class DERIVED>
+class IndexedBitsetBase
 {
 public:
-    IndexedBitset() = default;
-    IndexedBitset(size_t aBitCount) { create(aBitCount); }
-    void create(size_t aBitCount)
+    static constexpr size_t npos = SIZE_MAX;
+
+    // Set bits in ascending order. Keeps the rest of the current word, so
+    // only the step to the next non-empty word goes through the layers.
+    class const_iterator
     {
-        m_Data.clear();
-        if (aBitCount == 0)
-            return;
-        do
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = size_t;
+        using difference_type = ptrdiff_t;
+        using pointer = const size_t*;
+        using reference = size_t;
+
+        const_iterator() = default;
+        const_iterator(const IndexedBitsetBase* aSet, size_t aBit) : m_Set(aSet), m_Bit(aBit) { load(); }
+        size_t operator*() const { return m_Bit; }
+        const_iterator& operator++()
         {
-            aBitCount = (aBitCount + 63) / 64;
-            m_Data.emplace_back(aBitCount);
-        } while (aBitCount != 1);
-    }
+            m_Word &= m_Word - 1;
+            if (m_Word != 0)
+            {
+                m_Bit = (m_Bit & ~size_t(63)) + __builtin_ctzll(m_Word);
+                return *this;
+            }
+            m_Bit = m_Set->next((m_Bit | 63) + 1);
+            load();
+            return *this;
+        }
+        const_iterator operator++(int)
+        {
+            const_iterator sWas = *this;
+            ++*this;
+            return sWas;
+        }
+        bool operator==(const const_iterator& aOther) const { return m_Bit == aOther.m_Bit; }
+        bool operator!=(const const_iterator& aOther) const { return m_Bit != aOther.m_Bit; }
+
+    private:
+        // The bits of the current word from the current one up.
+        void load()
+        {
+            if (m_Bit != npos)
+                m_Word = m_Set->layer(0)[m_Bit / 64] & (~0ull << (m_Bit % 64));
+        }
+
+        const IndexedBitsetBase* m_Set = nullptr;
+        size_t m_Bit = npos;
+        uint64_t m_Word = 0;
+    };
+
     void set(size_t aBit)
     {
-        for (std::vector<uint64_t>& sLayer : m_Data)
+        for (size_t i = 0; i < layerCount(); i++)
         {
             size_t sWord = aBit / 64;
             size_t sMask = 1ull << (aBit % 64);
-            sLayer[sWord] |= sMask;
+            layer(i)[sWord] |= sMask;
             aBit = sWord;
         }
     }
     void clear(size_t aBit)
     {
-        for (std::vector<uint64_t>& sLayer : m_Data)
+        for (size_t i = 0; i < layerCount(); i++)
         {
             size_t sWord = aBit / 64;
             size_t sMask = 1ull << (aBit % 64);
-            sLayer[sWord] &= ~sMask;
-            if (sLayer[sWord] != 0)
+            layer(i)[sWord] &= ~sMask;
+            if (layer(i)[sWord] != 0)
                 break;
             aBit = sWord;
         }
@@ -47,22 +96,529 @@ public:
     {
         assert(!empty());
         size_t sBit = 0;
-        auto sItr = m_Data.cend();
+        size_t i = layerCount();
+        do
+        {
+            --i;
+            assert(layer(i)[sBit] != 0);
+            sBit = sBit * 64 + __builtin_ctzll(layer(i)[sBit]);
+
+        } while (i != 0);
+        return sBit;
+    }
+    size_t highest() const // must not be empty!
+    {
+        assert(!empty());
+        size_t sBit = 0;
+        size_t i = layerCount();
         do
         {
-            --sItr;
-            assert((*sItr)[sBit] != 0);
-            sBit = sBit * 64 + __builtin_ctzll((*sItr)[sBit]);
-            
-        } while (sItr != m_Data.cbegin());
+            --i;
+            assert(layer(i)[sBit] != 0);
+            sBit = sBit * 64 + 63 - __builtin_clzll(layer(i)[sBit]);
+
+        } while (i != 0);
         return sBit;
     }
+    // The lowest set bit not less than aBit, npos if none. Goes up the
+    // layers until a word has a set bit at or after the position, then down
+    // by the lowest bits: O(log64 n).
+    size_t next(size_t aBit) const
+    {
+        size_t sLayer = 0;
+        for (; sLayer < layerCount(); sLayer++)
+        {
+            size_t sWord = aBit / 64;
+            if (sWord >= layerSize(sLayer))
+                return npos;
+            uint64_t sBits = layer(sLayer)[sWord] & (~0ull << (aBit % 64));
+            if (sBits != 0)
+            {
+                aBit = sWord * 64 + __builtin_ctzll(sBits);
+                break;
+            }
+            aBit = sWord + 1;
+        }
+        if (sLayer == layerCount())
+            return npos;
+        while (sLayer-- > 0)
+            aBit = aBit * 64 + __builtin_ctzll(layer(sLayer)[aBit]);
+        return aBit;
+    }
+    // The highest set bit not greater than aBit, npos if none.
+    size_t prev(size_t aBit) const
+    {
+        size_t sLayer = 0;
+        for (; sLayer < layerCount(); sLayer++)
+        {
+            size_t sWord = aBit / 64;
+            uint64_t sMask = ~0ull >> (63 - aBit % 64);
+            if (sWord >= layerSize(sLayer))
+            {
+                sWord = layerSize(sLayer) - 1;
+                sMask = ~0ull;
+            }
+            uint64_t sBits = layer(sLayer)[sWord] & sMask;
+            if (sBits != 0)
+            {
+                aBit = sWord * 64 + 63 - __builtin_clzll(sBits);
+                break;
+            }
+            if (sWord == 0)
+                return npos;
+            aBit = sWord - 1;
+        }
+        if (sLayer == layerCount())
+            return npos;
+        while (sLayer-- > 0)
+            aBit = aBit * 64 + 63 - __builtin_clzll(layer(sLayer)[aBit]);
+        return aBit;
+    }
+    const_iterator begin() const { return const_iterator(this, next(0)); }
+    const_iterator end() const { return const_iterator(this, npos); }
     bool empty() const
     {
-        return m_Data.empty() || m_Data.back()[0] == 0;
+        return layerCount() == 0 || layer(layerCount() - 1)[0] == 0;
+    }
+    bool test(size_t aBit) const
+    {
+        return (layer(0)[aBit / 64] >> (aBit % 64)) & 1;
+    }
+    size_t count() const
+    {
+        size_t sCount = 0;
+        for (size_t i = 0; layerCount() != 0 && i < layerSize(0); i++)
+            sCount += popcount(layer(0)[i]);
+        return sCount;
+    }
+
+    // Sets bits [aBegin, aEnd) a word at a time. The words of the next layer
+    // to set are the ones the range touched.
+    void setRange(size_t aBegin, size_t aEnd)
+    {
+        for (size_t i = 0; i < layerCount() && aBegin < aEnd; i++)
+        {
+            fillRange(layer(i), aBegin, aEnd, true);
+            aBegin = aBegin / 64;
+            aEnd = (aEnd - 1) / 64 + 1;
+        }
+    }
+    // Clears bits [aBegin, aEnd). The words inside the range are empty now,
+    // the two at its ends maybe; the summary bits of the empty ones are the
+    // range to clear in the next layer.
+    void clearRange(size_t aBegin, size_t aEnd)
+    {
+        for (size_t i = 0; i < layerCount() && aBegin < aEnd; i++)
+        {
+            fillRange(layer(i), aBegin, aEnd, false);
+            size_t sFirst = aBegin / 64;
+            size_t sLast = (aEnd - 1) / 64;
+            aBegin = layer(i)[sFirst] == 0 ? sFirst : sFirst + 1;
+            aEnd = layer(i)[sLast] == 0 ? sLast + 1 : sLast;
+        }
+    }
+
+    // In place set operations with a bitset of the same size. Only the words
+    // that can change are visited: the ones set in this for &=, in the other
+    // for |= and in both for andNot().
+    template <class OTHER>
+    DERIVED& operator&=(const IndexedBitsetBase<OTHER>& aOther)
+    {
+        combine(aOther, [](uint64_t a, uint64_t b) { return a & b; }, [](uint64_t aMine, uint64_t) { return aMine; });
+        return static_cast<DERIVED&>(*this);
+    }
+    template <class OTHER>
+    DERIVED& operator|=(const IndexedBitsetBase<OTHER>& aOther)
+    {
+        combine(aOther, [](uint64_t a, uint64_t b) { return a | b; }, [](uint64_t, uint64_t aTheirs) { return aTheirs; });
+        return static_cast<DERIVED&>(*this);
+    }
+    template <class OTHER>
+    DERIVED& andNot(const IndexedBitsetBase<OTHER>& aOther)
+    {
+        combine(aOther, [](uint64_t a, uint64_t b) { return a & ~b; }, [](uint64_t aMine, uint64_t aTheirs) { return aMine & aTheirs; });
+        return static_cast<DERIVED&>(*this);
+    }
+
+protected:
+    // Layers of a bitset of aBitCount bits, up to 64^MAX_LAYERS bits.
+    static constexpr size_t MAX_LAYERS = 11;
+    static constexpr size_t layerCount(size_t aBitCount)
+    {
+        size_t sCount = 0;
+        while (aBitCount > 1 || (sCount == 0 && aBitCount == 1))
+        {
+            aBitCount = (aBitCount + 63) / 64;
+            sCount++;
+        }
+        return sCount;
+    }
+    static constexpr size_t layerSize(size_t aBitCount, size_t aLayer)
+    {
+        for (size_t i = 0; i <= aLayer; i++)
+            aBitCount = (aBitCount + 63) / 64;
+        return aBitCount;
+    }
+    // The layers are stored from the top one down, so the small upper ones
+    // share the first cache lines.
+    static constexpr size_t layerOffset(size_t aBitCount, size_t aLayer)
+    {
+        size_t sOffset = 0;
+        for (size_t i = aLayer + 1; i < layerCount(aBitCount); i++)
+            sOffset += layerSize(aBitCount, i);
+        return sOffset;
+    }
+
+private:
+    template <class> friend class IndexedBitsetBase;
+
+    static size_t popcount(uint64_t a)
+    {
+#if defined(__POPCNT__)
+        return __builtin_popcountll(a);
+#else
+        // Without the instruction the builtin is a libgcc call.
+        a -= (a >> 1) & 0x5555555555555555ull;
+        a = (a & 0x3333333333333333ull) + ((a >> 2) & 0x3333333333333333ull);
+        a = (a + (a >> 4)) & 0x0f0f0f0f0f0f0f0full;
+        return (a * 0x0101010101010101ull) >> 56;
+#endif
+    }
+    static void fillRange(uint64_t* aWords, size_t aBegin, size_t aEnd, bool aValue)
+    {
+        size_t sFirst = aBegin / 64;
+        size_t sLast = (aEnd - 1) / 64;
+        uint64_t sFirstMask = ~0ull << (aBegin % 64);
+        uint64_t sLastMask = ~0ull >> (63 - (aEnd - 1) % 64);
+        auto sApply = [aValue](uint64_t& aWord, uint64_t aMask) { aWord = aValue ? aWord | aMask : aWord & ~aMask; };
+        if (sFirst == sLast)
+        {
+            sApply(aWords[sFirst], sFirstMask & sLastMask);
+            return;
+        }
+        sApply(aWords[sFirst], sFirstMask);
+        std::fill(aWords + sFirst + 1, aWords + sLast, aValue ? ~0ull : 0ull);
+        sApply(aWords[sLast], sLastMask);
+    }
+    // Applies aOp to the words of layer 0 picked by aSelect from the summary
+    // words of both, 64 words per summary word. A block of 64 selected words
+    // goes by a plain loop the compiler vectorizes. Then the summary bits
+    // are updated, the upper layers only for the words that became empty or
+    // not empty.
+    template <class OTHER, class OP, class SELECT>
+    void combine(const IndexedBitsetBase<OTHER>& aOther, OP aOp, SELECT aSelect)
+    {
+        assert(layerCount() == aOther.layerCount() && (layerCount() == 0 || layerSize(0) == aOther.layerSize(0)));
+        if (layerCount() == 0)
+            return;
+        uint64_t* sWords = layer(0);
+        const uint64_t* sOtherWords = aOther.layer(0);
+        if (layerCount() == 1)
+        {
+            sWords[0] = aOp(sWords[0], sOtherWords[0]);
+            return;
+        }
+        uint64_t* sSummary = layer(1);
+        const uint64_t* sOtherSummary = aOther.layer(1);
+        for (size_t k = 0; k < layerSize(1); k++)
+        {
+            uint64_t sSelect = aSelect(sSummary[k], sOtherSummary[k]);
+            if (sSelect == 0)
+                continue;
+            uint64_t* sBlock = sWords + k * 64;
+            const uint64_t* sOtherBlock = sOtherWords + k * 64;
+            uint64_t sNonEmpty = sSummary[k] & ~sSelect;
+            if (sSelect == ~0ull)
+            {
+                for (size_t i = 0; i < 64; i++)
+                    sBlock[i] = aOp(sBlock[i], sOtherBlock[i]);
+                for (size_t i = 0; i < 64; i++)
+                    sNonEmpty |= static_cast<uint64_t>(sBlock[i] != 0) << i;
+            }
+            else
+            {
+                for (uint64_t sBits = sSelect; sBits != 0; sBits &= sBits - 1)
+                {
+                    size_t i = __builtin_ctzll(sBits);
+                    sBlock[i] = aOp(sBlock[i], sOtherBlock[i]);
+                    sNonEmpty |= static_cast<uint64_t>(sBlock[i] != 0) << i;
+                }
+            }
+            bool sWasEmpty = sSummary[k] == 0;
+            sSummary[k] = sNonEmpty;
+            if (sWasEmpty != (sNonEmpty == 0))
+                summarize(1, k);
+        }
+    }
+    // Word aWord of layer aLayer became empty or not empty.
+    void summarize(size_t aLayer, size_t aWord)
+    {
+        for (; aLayer + 1 < layerCount(); aLayer++)
+        {
+            uint64_t& sParent = layer(aLayer + 1)[aWord / 64];
+            bool sWasEmpty = sParent == 0;
+            if (layer(aLayer)[aWord] == 0)
+                sParent &= ~(1ull << (aWord % 64));
+            else
+                sParent |= 1ull << (aWord % 64);
+            if (sWasEmpty == (sParent == 0))
+                break;
+            aWord /= 64;
+        }
+    }
+
+    size_t layerCount() const { return static_cast<const DERIVED*>(this)->layerCount(); }
+    size_t layerSize(size_t aLayer) const { return static_cast<const DERIVED*>(this)->layerSize(aLayer); }
+    const uint64_t* layer(size_t aLayer) const { return static_cast<const DERIVED*>(this)->layer(aLayer); }
+    uint64_t* layer(size_t aLayer) { return static_cast<DERIVED*>(this)->layer(aLayer); }
+};
+
+// IndexedBitset of a size set at run time. All the layers are in one cache
+// line aligned allocation.
+class IndexedBitset : public IndexedBitsetBase<IndexedBitset>
+{
+    friend class IndexedBitsetBase<IndexedBitset>;
+public:
+    IndexedBitset() = default;
+    IndexedBitset(size_t aBitCount) { create(aBitCount); }
+    IndexedBitset(const IndexedBitset& aOther) { *this = aOther; }
+    IndexedBitset(IndexedBitset&& aOther) noexcept { *this = std::move(aOther); }
+    IndexedBitset& operator=(const IndexedBitset& aOther)
+    {
+        if (this == &aOther)
+            return *this;
+        create(aOther.m_BitCount);
+        std::copy(aOther.m_Words.get(), aOther.m_Words.get() + m_WordCount, m_Words.get());
+        return *this;
+    }
+    IndexedBitset& operator=(IndexedBitset&& aOther) noexcept
+    {
+        std::swap(m_Words, aOther.m_Words);
+        std::swap(m_WordCount, aOther.m_WordCount);
+        std::swap(m_BitCount, aOther.m_BitCount);
+        std::swap(m_Layers, aOther.m_Layers);
+        std::swap(m_Size, aOther.m_Size);
+        std::swap(m_Offset, aOther.m_Offset);
+        return *this;
+    }
+
+    void create(size_t aBitCount)
+    {
+        m_BitCount = aBitCount;
+        m_Layers = IndexedBitsetBase::layerCount(aBitCount);
+        assert(m_Layers <= MAX_LAYERS);
+        for (size_t i = 0; i < m_Layers; i++)
+        {
+            m_Size[i] = IndexedBitsetBase::layerSize(aBitCount, i);
+            m_Offset[i] = layerOffset(aBitCount, i);
+        }
+        size_t sWordCount = m_Layers == 0 ? 0 : m_Offset[0] + m_Size[0];
+        if (sWordCount != m_WordCount)
+        {
+            m_Words.reset(sWordCount == 0 ? nullptr
+                : static_cast<uint64_t*>(::operator new(sWordCount * sizeof(uint64_t), std::align_val_t(CACHE_LINE))));
+            m_WordCount = sWordCount;
+        }
+        std::fill(m_Words.get(), m_Words.get() + m_WordCount, 0);
     }
+    // Like create(), but keeps the bits that are set; must not shrink.
+    void grow(size_t aBitCount)
+    {
+        std::vector<uint64_t> sBits;
+        if (m_Layers != 0)
+            sBits.assign(layer(0), layer(0) + m_Size[0]);
+        create(aBitCount);
+        if (m_Layers == 0)
+            return;
+        assert(sBits.size() <= m_Size[0]);
+        std::copy(sBits.begin(), sBits.end(), layer(0));
+        for (size_t i = 1; i < m_Layers; i++)
+        {
+            for (size_t j = 0; j < m_Size[i - 1]; j++)
+            {
+                if (layer(i - 1)[j] != 0)
+                    layer(i)[j / 64] |= 1ull << (j % 64);
+            }
+        }
+    }
+
+private:
+    static constexpr size_t CACHE_LINE = 64;
+
+    struct Free
+    {
+        void operator()(uint64_t* aWords) const { ::operator delete(aWords, std::align_val_t(CACHE_LINE)); }
+    };
+
+    size_t layerCount() const { return m_Layers; }
+    size_t layerSize(size_t aLayer) const { return m_Size[aLayer]; }
+    const uint64_t* layer(size_t aLayer) const { return m_Words.get() + m_Offset[aLayer]; }
+    uint64_t* layer(size_t aLayer) { return m_Words.get() + m_Offset[aLayer]; }
+
+    std::unique_ptr<uint64_t[], Free> m_Words;
+    size_t m_WordCount = 0;
+    size_t m_BitCount = 0;
+    size_t m_Layers = 0;
+    size_t m_Size[MAX_LAYERS]{};
+    size_t m_Offset[MAX_LAYERS]{};
+};
+
+// IndexedBitset of BITS bits known at compile time: no allocation, and the
+// layer sizes and offsets are constants.
+template <size_t BITS>
+class StaticIndexedBitset : public IndexedBitsetBase<StaticIndexedBitset<BITS>>
+{
+    using Base = IndexedBitsetBase<StaticIndexedBitset<BITS>>;
+    friend Base;
+public:
+    static_assert(BITS > 0, "Expected some bits");
+
 private:
+    static constexpr size_t LAYERS = Base::layerCount(BITS);
+    static constexpr size_t WORDS = Base::layerOffset(BITS, 0) + Base::layerSize(BITS, 0);
+
+    static constexpr std::array<size_t, LAYERS> makeOffsets()
+    {
+        std::array<size_t, LAYERS> sOffsets{};
+        for (size_t i = 0; i < LAYERS; i++)
+            sOffsets[i] = Base::layerOffset(BITS, i);
+        return sOffsets;
+    }
+    static constexpr std::array<size_t, LAYERS> OFFSETS = makeOffsets();
 
-    std::vector<std::vector<uint64_t> > m_Data;
+    static constexpr size_t layerCount() { return LAYERS; }
+    static constexpr size_t layerSize(size_t aLayer) { return Base::layerSize(BITS, aLayer); }
+    const uint64_t* layer(size_t aLayer) const { return m_Words.data() + OFFSETS[aLayer]; }
+    uint64_t* layer(size_t aLayer) { return m_Words.data() + OFFSETS[aLayer]; }
+
+    alignas(64) std::array<uint64_t, WORDS> m_Words{};
+};
+
+// IndexedBitset that can be shared between threads: set(), clear() and
+// claimLowest() are lock free. create() is not and must be done first.
+//
+// A summary bit may be set over an empty word (a bit was set and cleared
+// again before the summary was updated), but never left clear over a word
+// with bits: whoever makes a word non-empty sets the summary bit above, and
+// whoever clears the summary bit of a word rechecks the word and sets the bit
+// back if it is not empty any more. The readers step over a false positive by
+// clearing it the same way and retrying.
+class ConcurrentIndexedBitset
+{
+public:
+    static constexpr size_t npos = SIZE_MAX;
+
+    ConcurrentIndexedBitset() = default;
+    ConcurrentIndexedBitset(size_t aBitCount) { create(aBitCount); }
+    void create(size_t aBitCount)
+    {
+        m_Data.clear();
+        if (aBitCount == 0)
+            return;
+        do
+        {
+            aBitCount = (aBitCount + 63) / 64;
+            m_Data.emplace_back(aBitCount);
+        } while (aBitCount != 1);
+    }
+    // Returns false if the bit was set already.
+    bool set(size_t aBit)
+    {
+        uint64_t sMask = 1ull << (aBit % 64);
+        uint64_t sWas = m_Data[0][aBit / 64].fetch_or(sMask);
+        if (sWas == 0)
+            setSummary(1, aBit / 64);
+        return (sWas & sMask) == 0;
+    }
+    // Returns false if the bit was clear already: the caller of the clear()
+    // that returns true is the only one that took the bit.
+    bool clear(size_t aBit)
+    {
+        uint64_t sMask = 1ull << (aBit % 64);
+        uint64_t sWas = m_Data[0][aBit / 64].fetch_and(~sMask);
+        if (sWas == sMask)
+            clearSummary(1, aBit / 64);
+        return (sWas & sMask) != 0;
+    }
+    bool test(size_t aBit) const
+    {
+        return (m_Data[0][aBit / 64].load() >> (aBit % 64)) & 1;
+    }
+    // The lowest set bit, npos if none. It may be cleared by another thread
+    // before the caller uses it.
+    size_t lowest()
+    {
+        if (m_Data.empty())
+            return npos;
+        for (;;)
+        {
+            size_t sBit = 0;
+            size_t sLayer = m_Data.size();
+            while (sLayer-- > 0)
+            {
+                uint64_t sWord = m_Data[sLayer][sBit].load();
+                if (sWord == 0)
+                    break;
+                sBit = sBit * 64 + __builtin_ctzll(sWord);
+            }
+            if (sLayer == SIZE_MAX)
+                return sBit;
+            if (sLayer + 1 == m_Data.size())
+                return npos;
+            clearSummary(sLayer + 1, sBit);
+        }
+    }
+    // Takes the lowest set bit: clears it and returns it, npos if none. Each
+    // bit that was set is taken by one caller only.
+    size_t claimLowest()
+    {
+        for (;;)
+        {
+            size_t sBit = lowest();
+            if (sBit == npos || clear(sBit))
+                return sBit;
+        }
+    }
+    // May be false for a set that is empty but has false positive summary
+    // bits left; lowest() returns npos then.
+    bool empty() const
+    {
+        return m_Data.empty() || m_Data.back()[0].load() == 0;
+    }
+
+private:
+    // Word aWord of layer aLayer - 1 became non-empty.
+    void setSummary(size_t aLayer, size_t aWord)
+    {
+        for (; aLayer < m_Data.size(); aLayer++)
+        {
+            // Usually set already; a clear that races with the load rechecks.
+            std::atomic<uint64_t>& sSummary = m_Data[aLayer][aWord / 64];
+            uint64_t sMask = 1ull << (aWord % 64);
+            if ((sSummary.load() & sMask) != 0 || sSummary.fetch_or(sMask) != 0)
+                break;
+            aWord /= 64;
+        }
+    }
+    // Word aWord of layer aLayer - 1 was seen empty.
+    void clearSummary(size_t aLayer, size_t aWord)
+    {
+        for (; aLayer < m_Data.size(); aLayer++)
+        {
+            uint64_t sMask = 1ull << (aWord % 64);
+            uint64_t sWas = m_Data[aLayer][aWord / 64].fetch_and(~sMask);
+            if (m_Data[aLayer - 1][aWord].load() != 0)
+            {
+                // Set again meanwhile: its setter may have seen our bit
+                // still set and stopped.
+                setSummary(aLayer, aWord);
+                return;
+            }
+            if (sWas != sMask)
+                return;
+            aWord /= 64;
+        }
+    }
 
-};
\ No newline at end of file
+    std::vector<std::vector<std::atomic<uint64_t>>> m_Data;
+};
@@ -0,0 +1,285 @@
+#include <IndexedBitset.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+const size_t BITS = 16 * 1024 * 1024;
+
+static void checkpoint(const char* aText, size_t aOpCount)
+{
+    using namespace std::chrono;
+    high_resolution_clock::time_point now = high_resolution_clock::now();
+    static high_resolution_clock::time_point was;
+    duration<double> time_span = duration_cast<duration<double>>(now - was);
+    if (0 != aOpCount)
+    {
+        double Mrps = aOpCount / 1000000. / time_span.count();
+        std::cout << aText << ":\t" << Mrps << " Mrps" << std::endl;
+    }
+    was = now;
+}
+
+// Walks all the set bits and answers random "next set bit" queries, by the
+// summary layers of IndexedBitset and by a scan of std::vector<bool>.
+void run(size_t aDensity)
+{
+    std::cout << "Set bits per million: " << aDensity << std::endl;
+    IndexedBitset b(BITS);
+    std::vector<bool> v(BITS);
+    size_t sCount = 0;
+    for (size_t i = 0; i < BITS; i++)
+    {
+        if (static_cast<size_t>(rand() % 1000000) < aDensity)
+        {
+            b.set(i);
+            v[i] = true;
+            sCount++;
+        }
+    }
+
+    const size_t ROUNDS = 4;
+    size_t sum = 0;
+    checkpoint("", 0);
+    for (size_t r = 0; r < ROUNDS; r++)
+        for (size_t i : b)
+            sum += i;
+    checkpoint("iterate IndexedBitset", ROUNDS * sCount);
+    std::cout << "Check: " << sum << std::endl;
+
+    sum = 0;
+    checkpoint("", 0);
+    for (size_t r = 0; r < ROUNDS; r++)
+        for (size_t i = 0; i < BITS; i++)
+            if (v[i])
+                sum += i;
+    checkpoint("iterate vector<bool>", ROUNDS * sCount);
+    std::cout << "Check: " << sum << std::endl;
+
+    const size_t QUERIES = 1024;
+    std::vector<size_t> sQueries(QUERIES);
+    for (size_t& q : sQueries)
+        q = rand() % BITS;
+
+    sum = 0;
+    checkpoint("", 0);
+    for (size_t r = 0; r < ROUNDS * 1024; r++)
+        for (size_t q : sQueries)
+            sum += b.next(q);
+    checkpoint("next IndexedBitset", ROUNDS * 1024 * QUERIES);
+    std::cout << "Check: " << sum << std::endl;
+
+    sum = 0;
+    checkpoint("", 0);
+    for (size_t q : sQueries)
+    {
+        size_t i = q;
+        while (i < BITS && !v[i])
+            i++;
+        sum += i < BITS ? i : IndexedBitset::npos;
+    }
+    checkpoint("next vector<bool>", QUERIES);
+    std::cout << "Check: " << sum * ROUNDS * 1024 << std::endl;
+    std::cout << std::endl;
+}
+
+// Work distribution: every thread adds an item and takes the lowest one, on
+// a ConcurrentIndexedBitset vs IndexedBitset under a mutex. A backlog of
+// items is queued in advance.
+void runContention(size_t aThreads)
+{
+    const size_t SLOTS = 64 * 1024;
+    const size_t OPS = 1024 * 1024;
+    std::cout << "Threads: " << aThreads << std::endl;
+
+    ConcurrentIndexedBitset c(SLOTS);
+    for (size_t i = 0; i < SLOTS; i += 4)
+        c.set(i);
+    std::atomic<size_t> sum(0);
+    std::vector<std::thread> sThreads;
+    checkpoint("", 0);
+    for (size_t t = 0; t < aThreads; t++)
+    {
+        sThreads.emplace_back([&, t]()
+        {
+            size_t sSum = 0;
+            for (size_t i = 0; i < OPS; i++)
+            {
+                c.set((i * 64 + t) % SLOTS);
+                sSum += c.claimLowest();
+            }
+            sum += sSum;
+        });
+    }
+    for (std::thread& sThread : sThreads)
+        sThread.join();
+    checkpoint("ConcurrentIndexedBitset", aThreads * OPS);
+    std::cout << "Check: " << (sum.load() != 0) << std::endl;
+
+    IndexedBitset b(SLOTS);
+    for (size_t i = 0; i < SLOTS; i += 4)
+        b.set(i);
+    std::mutex m;
+    sum = 0;
+    sThreads.clear();
+    checkpoint("", 0);
+    for (size_t t = 0; t < aThreads; t++)
+    {
+        sThreads.emplace_back([&, t]()
+        {
+            size_t sSum = 0;
+            for (size_t i = 0; i < OPS; i++)
+            {
+                std::lock_guard<std::mutex> sLock(m);
+                b.set((i * 64 + t) % SLOTS);
+                size_t sBit = b.lowest();
+                b.clear(sBit);
+                sSum += sBit;
+            }
+            sum += sSum;
+        });
+    }
+    for (std::thread& sThread : sThreads)
+        sThread.join();
+    checkpoint("IndexedBitset + mutex", aThreads * OPS);
+    std::cout << "Check: " << (sum.load() != 0) << std::endl;
+    std::cout << std::endl;
+}
+
+// Pops (lowest() and clear()) random bits out of a set of BITS bits.
+template <class SET>
+void runPop(SET& aSet, const char* aName, size_t aBits)
+{
+    const size_t COUNT = std::min<size_t>(aBits / 2, 1024 * 1024);
+    const size_t ROUNDS = 16 * 1024 * 1024 / COUNT;
+    size_t sum = 0;
+    double sTime = 0;
+    for (size_t r = 0; r < ROUNDS; r++)
+    {
+        for (size_t i = 0; i < COUNT; i++)
+            aSet.set((static_cast<size_t>(rand()) << 16 ^ rand()) % aBits);
+        auto sStart = std::chrono::high_resolution_clock::now();
+        size_t sCount = 0;
+        while (!aSet.empty())
+        {
+            size_t sBit = aSet.lowest();
+            aSet.clear(sBit);
+            sum += sBit;
+            sCount++;
+        }
+        sTime += std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - sStart).count() / sCount;
+    }
+    std::cout << aName << ":\t" << ROUNDS / sTime / 1000000. << " Mrps" << std::endl;
+    std::cout << "Check: " << sum << std::endl;
+}
+
+template <size_t BITS>
+void runPop()
+{
+    std::cout << "Bits: " << BITS << std::endl;
+    IndexedBitset b(BITS);
+    runPop(b, "pop IndexedBitset", BITS);
+    static StaticIndexedBitset<BITS> s;
+    runPop(s, "pop StaticIndexedBitset", BITS);
+    std::cout << std::endl;
+}
+
+// Marks 10000 bit regions a word at a time vs a bit at a time.
+void runRange()
+{
+    const size_t BITS = 16 * 1024 * 1024;
+    const size_t RANGE = 10000;
+    std::cout << "Ranges of " << RANGE << " bits" << std::endl;
+    IndexedBitset r(BITS);
+    checkpoint("", 0);
+    for (size_t i = 0; i + RANGE <= BITS; i += RANGE)
+        r.setRange(i, i + RANGE);
+    checkpoint("setRange", BITS / RANGE * RANGE);
+    checkpoint("", 0);
+    for (size_t i = 0; i + RANGE <= BITS; i += RANGE)
+        for (size_t j = i; j < i + RANGE; j++)
+            r.set(j);
+    checkpoint("set per bit", BITS / RANGE * RANGE);
+    checkpoint("", 0);
+    for (size_t i = 0; i + RANGE <= BITS; i += RANGE)
+        r.clearRange(i, i + RANGE);
+    checkpoint("clearRange", BITS / RANGE * RANGE);
+    std::cout << "Check: " << r.empty() << std::endl;
+    std::cout << std::endl;
+}
+
+// Set algebra a word at a time vs a bit at a time.
+void runAlgebra(size_t aDensity)
+{
+    const size_t BITS = 16 * 1024 * 1024;
+    std::cout << "Set bits per million: " << aDensity << std::endl;
+
+    IndexedBitset a(BITS);
+    IndexedBitset b(BITS);
+    std::vector<bool> va(BITS);
+    std::vector<bool> vb(BITS);
+    for (size_t i = 0; i < BITS; i++)
+    {
+        if (static_cast<size_t>(rand() % 1000000) < aDensity)
+        {
+            a.set(i);
+            va[i] = true;
+        }
+        if (static_cast<size_t>(rand() % 1000000) < aDensity)
+        {
+            b.set(i);
+            vb[i] = true;
+        }
+    }
+
+    const size_t ROUNDS = 8;
+    size_t sum = 0;
+    checkpoint("", 0);
+    for (size_t k = 0; k < ROUNDS; k++)
+    {
+        IndexedBitset c = a;
+        c |= b;
+        c &= a;
+        c.andNot(b);
+        sum += c.count();
+    }
+    checkpoint("copy, |=, &=, andNot, count", ROUNDS * BITS);
+    std::cout << "Check: " << sum << std::endl;
+
+    sum = 0;
+    checkpoint("", 0);
+    for (size_t k = 0; k < ROUNDS; k++)
+    {
+        std::vector<bool> c = va;
+        for (size_t i = 0; i < BITS; i++)
+            c[i] = c[i] || vb[i];
+        for (size_t i = 0; i < BITS; i++)
+            c[i] = c[i] && va[i];
+        for (size_t i = 0; i < BITS; i++)
+            c[i] = c[i] && !vb[i];
+        sum += std::count(c.begin(), c.end(), true);
+    }
+    checkpoint("vector<bool> per bit", ROUNDS * BITS);
+    std::cout << "Check: " << sum << std::endl;
+    std::cout << std::endl;
+}
+
+int main()
+{
+    srand(time(nullptr));
+    runPop<1024>();
+    runPop<64 * 1024>();
+    runPop<16 * 1024 * 1024>();
+    runPop<1024 * 1024 * 1024>();
+    for (size_t sDensity : {10, 1000, 100000, 900000})
+        run(sDensity);
+    for (size_t sThreads : {1, 2, 4, 8})
+        runContention(sThreads);
+    runRange();
+    for (size_t sDensity : {100, 500000})
+        runAlgebra(sDensity);
+}
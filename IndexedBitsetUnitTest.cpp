@@ -1,7 +1,11 @@
 #include <IndexedBitset.hpp>
 
+#include <algorithm>
+#include <atomic>
 #include <iostream>
 #include <set>
+#include <thread>
+#include <vector>
 
 void check(bool aExpession, const char* aMessage)
 {
@@ -12,10 +16,10 @@ void check(bool aExpession, const char* aMessage)
     }
 }
 
-void test(size_t aBitCount)
+template <class SET>
+void test(SET& b, size_t aBitCount)
 {
     size_t sRuns = 1000 + aBitCount * 10;
-    IndexedBitset b(aBitCount);
     std::set<size_t> c;
     for (size_t i = 0; i < sRuns; i++)
     {
@@ -34,7 +38,298 @@ void test(size_t aBitCount)
         check(b.empty() == c.empty(), "empty check failed");
         if (!b.empty())
             check(b.lowest() == *c.begin(), "lowest check failed");
+        if (!b.empty())
+            check(b.highest() == *c.rbegin(), "highest check failed");
+    }
+    check(std::vector<size_t>(b.begin(), b.end()) == std::vector<size_t>(c.begin(), c.end()), "iteration check failed");
+}
+
+void test(size_t aBitCount)
+{
+    IndexedBitset b(aBitCount);
+    test(b, aBitCount);
+
+    IndexedBitset sCopy(b);
+    check(std::equal(sCopy.begin(), sCopy.end(), b.begin(), b.end()), "copy check failed");
+    IndexedBitset sMoved(std::move(sCopy));
+    check(std::equal(sMoved.begin(), sMoved.end(), b.begin(), b.end()), "move check failed");
+    sCopy = sMoved;
+    sMoved.clear(*sMoved.begin());
+    check(std::equal(sCopy.begin(), sCopy.end(), b.begin(), b.end()), "copy assignment check failed");
+}
+
+void testGrow(size_t aBitCount, size_t aNewBitCount)
+{
+    IndexedBitset b(aBitCount);
+    std::set<size_t> c;
+    for (size_t i = 0; i < aBitCount / 3 + 1; i++)
+    {
+        size_t sPos = rand() % aBitCount;
+        b.set(sPos);
+        c.insert(sPos);
+    }
+    b.grow(aNewBitCount);
+    b.set(aNewBitCount - 1);
+    c.insert(aNewBitCount - 1);
+    while (!c.empty())
+    {
+        check(!b.empty(), "empty check failed");
+        check(b.lowest() == *c.begin(), "lowest check failed");
+        check(b.highest() == *c.rbegin(), "highest check failed");
+        b.clear(*c.begin());
+        c.erase(c.begin());
+    }
+    check(b.empty(), "empty check failed");
+}
+
+template <class SET>
+void testNext(SET& b, size_t aBitCount, size_t aDensity)
+{
+    std::set<size_t> c;
+    for (size_t i = 0; i < aBitCount; i++)
+    {
+        if (static_cast<size_t>(rand() % 1000) < aDensity)
+        {
+            b.set(i);
+            c.insert(i);
+        }
+    }
+    for (size_t i = 0; i < aBitCount + 130; i++)
+    {
+        auto sNext = c.lower_bound(i);
+        check(b.next(i) == (sNext == c.end() ? IndexedBitset::npos : *sNext), "next check failed");
+        auto sPrev = c.upper_bound(i);
+        check(b.prev(i) == (sPrev == c.begin() ? IndexedBitset::npos : *--sPrev), "prev check failed");
+    }
+    check(std::vector<size_t>(b.begin(), b.end()) == std::vector<size_t>(c.begin(), c.end()), "iteration check failed");
+}
+
+void testNext(size_t aBitCount, size_t aDensity)
+{
+    IndexedBitset b(aBitCount);
+    testNext(b, aBitCount, aDensity);
+}
+
+template <size_t BITS>
+void testStatic()
+{
+    StaticIndexedBitset<BITS> b;
+    check(b.empty(), "static empty check failed");
+    test(b, BITS);
+    for (size_t sDensity : {0, 10, 1000})
+    {
+        StaticIndexedBitset<BITS> n;
+        testNext(n, BITS, sDensity);
+    }
+}
+
+// Sets of the same size in a pattern: random bits, random ranges or empty.
+template <class SET>
+void fill(SET& b, std::vector<bool>& v, size_t aBitCount)
+{
+    size_t sKind = rand() % 4;
+    for (size_t i = 0; sKind == 0 && i < aBitCount / 8 + 1; i++)
+    {
+        size_t sPos = rand() % aBitCount;
+        b.set(sPos);
+        v[sPos] = true;
+    }
+    for (size_t i = 0; sKind == 1 && i < 4; i++)
+    {
+        size_t sBegin = rand() % aBitCount;
+        size_t sEnd = sBegin + rand() % (aBitCount - sBegin + 1);
+        b.setRange(sBegin, sEnd);
+        std::fill(v.begin() + sBegin, v.begin() + sEnd, true);
+    }
+    if (sKind == 2)
+    {
+        b.setRange(0, aBitCount);
+        v.assign(aBitCount, true);
+    }
+}
+
+// The bits, the count and the summary layers (by iteration and prev()) are
+// the ones of the std::vector<bool>.
+template <class SET>
+void compare(const SET& b, const std::vector<bool>& v, const char* aMessage)
+{
+    std::vector<size_t> sExpected;
+    for (size_t i = 0; i < v.size(); i++)
+    {
+        check(b.test(i) == v[i], aMessage);
+        if (v[i])
+            sExpected.push_back(i);
+    }
+    check(b.count() == sExpected.size(), aMessage);
+    check(std::vector<size_t>(b.begin(), b.end()) == sExpected, aMessage);
+    check(b.empty() == sExpected.empty(), aMessage);
+    if (!sExpected.empty())
+        check(b.prev(v.size()) == sExpected.back() && b.highest() == sExpected.back(), aMessage);
+}
+
+void testRange(size_t aBitCount)
+{
+    IndexedBitset b(aBitCount);
+    std::vector<bool> v(aBitCount);
+    for (size_t i = 0; i < 200; i++)
+    {
+        size_t sBegin = rand() % (aBitCount + 1);
+        size_t sEnd = sBegin + rand() % (std::min<size_t>(aBitCount - sBegin, rand() % 2 ? 100 : aBitCount) + 1);
+        if (rand() % 3 == 0)
+        {
+            b.clearRange(sBegin, sEnd);
+            std::fill(v.begin() + sBegin, v.begin() + sEnd, false);
+        }
+        else
+        {
+            b.setRange(sBegin, sEnd);
+            std::fill(v.begin() + sBegin, v.begin() + sEnd, true);
+        }
+        if (i % 16 == 0 || aBitCount < 1000)
+            compare(b, v, "range check failed");
     }
+    compare(b, v, "range check failed");
+}
+
+void testAlgebra(size_t aBitCount)
+{
+    for (size_t i = 0; i < 30; i++)
+    {
+        IndexedBitset a(aBitCount);
+        IndexedBitset b(aBitCount);
+        std::vector<bool> va(aBitCount);
+        std::vector<bool> vb(aBitCount);
+        fill(a, va, aBitCount);
+        fill(b, vb, aBitCount);
+        size_t sOp = i % 3;
+        if (sOp == 0)
+            a &= b;
+        else if (sOp == 1)
+            a |= b;
+        else
+            a.andNot(b);
+        for (size_t j = 0; j < aBitCount; j++)
+            va[j] = sOp == 0 ? va[j] && vb[j] : sOp == 1 ? va[j] || vb[j] : va[j] && !vb[j];
+        compare(a, va, "algebra check failed");
+    }
+}
+
+template <size_t BITS>
+void testStaticAlgebra()
+{
+    StaticIndexedBitset<BITS> a;
+    IndexedBitset b(BITS);
+    std::vector<bool> va(BITS);
+    std::vector<bool> vb(BITS);
+    a.setRange(BITS / 4, BITS);
+    std::fill(va.begin() + BITS / 4, va.end(), true);
+    fill(b, vb, BITS);
+    a.andNot(b);
+    for (size_t j = 0; j < BITS; j++)
+        va[j] = va[j] && !vb[j];
+    compare(a, va, "static algebra check failed");
+}
+
+// The single threaded behaviour is the one of IndexedBitset.
+void testConcurrentSerial(size_t aBitCount)
+{
+    ConcurrentIndexedBitset b(aBitCount);
+    std::set<size_t> c;
+    for (size_t i = 0; i < 1000 + aBitCount * 10; i++)
+    {
+        size_t sPos = rand() % aBitCount;
+        if (rand() & 1)
+            check(b.set(sPos) == c.insert(sPos).second, "concurrent set check failed");
+        else
+            check(b.clear(sPos) == (c.erase(sPos) != 0), "concurrent clear check failed");
+        check(b.test(sPos) == (c.count(sPos) != 0), "concurrent test check failed");
+        check(b.lowest() == (c.empty() ? ConcurrentIndexedBitset::npos : *c.begin()), "concurrent lowest check failed");
+    }
+    while (!c.empty())
+    {
+        check(b.claimLowest() == *c.begin(), "concurrent claim check failed");
+        c.erase(c.begin());
+    }
+    check(b.claimLowest() == ConcurrentIndexedBitset::npos, "concurrent claim of empty check failed");
+}
+
+// Producers set every bit once, in their own order; consumers claim them all
+// concurrently. Every bit must be taken exactly once.
+void testConcurrentClaim(size_t aBitCount, size_t aProducers, size_t aConsumers)
+{
+    ConcurrentIndexedBitset b(aBitCount);
+    std::vector<std::atomic<size_t>> sTaken(aBitCount);
+    std::atomic<size_t> sLeft(aBitCount);
+    std::vector<std::thread> sThreads;
+    for (size_t t = 0; t < aProducers; t++)
+    {
+        sThreads.emplace_back([&, t]()
+        {
+            for (size_t i = t; i < aBitCount; i += aProducers)
+                b.set(aBitCount - 1 - (i * 7919) % aBitCount);
+        });
+    }
+    for (size_t t = 0; t < aConsumers; t++)
+    {
+        sThreads.emplace_back([&]()
+        {
+            while (sLeft.load() != 0)
+            {
+                size_t sBit = b.claimLowest();
+                if (sBit == ConcurrentIndexedBitset::npos)
+                {
+                    std::this_thread::yield();
+                    continue;
+                }
+                sTaken[sBit]++;
+                sLeft--;
+            }
+        });
+    }
+    for (std::thread& sThread : sThreads)
+        sThread.join();
+    for (std::atomic<size_t>& sCount : sTaken)
+        check(sCount.load() == 1, "concurrent claim count check failed");
+    check(b.lowest() == ConcurrentIndexedBitset::npos, "concurrent claim leftover check failed");
+}
+
+// Threads set and clear their own bits, interleaved so that they share the
+// words; the summary must not lose any bit that stays set.
+void testConcurrentSummary(size_t aBitCount, size_t aThreads)
+{
+    ConcurrentIndexedBitset b(aBitCount);
+    std::vector<std::set<size_t>> sExpected(aThreads);
+    std::vector<std::thread> sThreads;
+    for (size_t t = 0; t < aThreads; t++)
+    {
+        sThreads.emplace_back([&, t]()
+        {
+            unsigned sSeed = t + 1;
+            for (size_t i = 0; i < 100000; i++)
+            {
+                sSeed = sSeed * 1103515245 + 12345;
+                size_t sBit = (sSeed >> 8) % (aBitCount / aThreads) * aThreads + t;
+                if ((sSeed >> 4) % 3 == 0)
+                {
+                    b.set(sBit);
+                    sExpected[t].insert(sBit);
+                }
+                else
+                {
+                    b.clear(sBit);
+                    sExpected[t].erase(sBit);
+                }
+            }
+        });
+    }
+    for (std::thread& sThread : sThreads)
+        sThread.join();
+    std::set<size_t> sAll;
+    for (const std::set<size_t>& sBits : sExpected)
+        sAll.insert(sBits.begin(), sBits.end());
+    for (size_t sBit : sAll)
+        check(b.claimLowest() == sBit, "concurrent summary check failed");
+    check(b.claimLowest() == ConcurrentIndexedBitset::npos, "concurrent summary leftover check failed");
 }
 
 int main()
@@ -52,6 +347,42 @@ int main()
         test(64);
         test(65);
         test(1000);
+        testGrow(1, 1);
+        testGrow(1, 2);
+        testGrow(64, 65);
+        testGrow(100, 5000);
+        testGrow(5000, 300000);
+        IndexedBitset e;
+        check(e.next(0) == IndexedBitset::npos && e.prev(0) == IndexedBitset::npos, "empty next check failed");
+        check(e.begin() == e.end(), "empty iteration check failed");
+        for (size_t sBitCount : {1, 2, 63, 64, 65, 4096, 4097, 300000})
+        {
+            for (size_t sDensity : {0, 1, 10, 500, 1000})
+                testNext(sBitCount, sDensity);
+        }
+        for (size_t sBitCount : {1, 63, 64, 65, 4095, 4096, 4097, 300000})
+        {
+            testRange(sBitCount);
+            testAlgebra(sBitCount);
+        }
+        testStaticAlgebra<1>();
+        testStaticAlgebra<5000>();
+        testStatic<1>();
+        testStatic<64>();
+        testStatic<65>();
+        testStatic<4097>();
+        StaticIndexedBitset<300000> sLarge;
+        testNext(sLarge, 300000, 10);
+        ConcurrentIndexedBitset ce;
+        check(ce.empty() && ce.lowest() == ConcurrentIndexedBitset::npos, "concurrent empty check failed");
+        testConcurrentSerial(1);
+        testConcurrentSerial(65);
+        testConcurrentSerial(5000);
+        testConcurrentClaim(1, 1, 1);
+        testConcurrentClaim(100000, 2, 4);
+        testConcurrentClaim(300000, 4, 2);
+        testConcurrentSummary(256, 4);
+        testConcurrentSummary(300000, 8);
     }
     catch (const std::exception& e)
     {
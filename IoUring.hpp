@@ -0,0 +1,232 @@
+#pragma once
+
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+
+#if defined(BANLOG_IO_URING) && __has_include(<linux/io_uring.h>)
+#define BANLOG_IO_URING_ENABLED 1
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#else
+#define BANLOG_IO_URING_ENABLED 0
+#endif
+
+// Minimal io_uring wrapper for batched reads, no liburing needed.
+// create() returns false when io_uring is not built in or not permitted
+// by the kernel, the caller is expected to fall back to pread.
+class IoUring
+{
+public:
+    IoUring() = default;
+    ~IoUring() { destroy(); }
+
+    bool create(unsigned aEntries);
+    void destroy();
+    bool active() const { return m_Fd >= 0; }
+    // Reads into that buffer use IORING_OP_READ_FIXED, other reads use
+    // IORING_OP_READ. Returns false if registration is not permitted.
+    bool registerBuffer(void* aData, size_t aSize);
+    // Returns false if submission queue is full.
+    bool prepareRead(int aFd, void* aBuf, size_t aSize, uint64_t aOffset, uint64_t aUserData);
+    // Submits prepared reads and waits for at least aWaitCount completions.
+    void submit(unsigned aWaitCount);
+    // Pops a completion, returns false if there is none.
+    bool complete(uint64_t& aUserData, int& aResult);
+    size_t inflight() const { return m_Inflight; }
+    size_t capacity() const { return m_Entries; }
+
+private:
+    IoUring(const IoUring&) = delete;
+    IoUring& operator=(const IoUring&) = delete;
+
+    int m_Fd = -1;
+    unsigned m_Entries = 0;
+    unsigned m_Prepared = 0; // Published to the queue but not submitted.
+    size_t m_Inflight = 0;
+    char* m_Buffer = nullptr;
+    size_t m_BufferSize = 0;
+#if BANLOG_IO_URING_ENABLED
+    void* m_SqRing = nullptr;
+    size_t m_SqRingSize = 0;
+    void* m_CqRing = nullptr;
+    size_t m_CqRingSize = 0;
+    io_uring_sqe* m_Sqes = nullptr;
+    size_t m_SqesSize = 0;
+    unsigned* m_SqHead = nullptr;
+    unsigned* m_SqTail = nullptr;
+    unsigned m_SqLocalTail = 0;
+    unsigned m_SqMask = 0;
+    unsigned* m_SqArray = nullptr;
+    unsigned* m_CqHead = nullptr;
+    unsigned* m_CqTail = nullptr;
+    unsigned m_CqMask = 0;
+    io_uring_cqe* m_Cqes = nullptr;
+#endif
+};
+
+#if BANLOG_IO_URING_ENABLED
+
+inline bool IoUring::create(unsigned aEntries)
+{
+    destroy();
+    io_uring_params sParams;
+    memset(&sParams, 0, sizeof(sParams));
+    int sFd = syscall(__NR_io_uring_setup, aEntries, &sParams);
+    if (sFd < 0)
+        return false;
+    m_Fd = sFd;
+    m_Entries = sParams.sq_entries;
+
+    m_SqRingSize = sParams.sq_off.array + sParams.sq_entries * sizeof(unsigned);
+    m_CqRingSize = sParams.cq_off.cqes + sParams.cq_entries * sizeof(io_uring_cqe);
+    bool sSingle = (sParams.features & IORING_FEAT_SINGLE_MMAP) != 0;
+    if (sSingle)
+        m_SqRingSize = m_CqRingSize = std::max(m_SqRingSize, m_CqRingSize);
+
+    m_SqRing = mmap(nullptr, m_SqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_Fd, IORING_OFF_SQ_RING);
+    if (m_SqRing == MAP_FAILED)
+    {
+        m_SqRing = nullptr;
+        destroy();
+        return false;
+    }
+    if (sSingle)
+    {
+        m_CqRing = m_SqRing;
+    }
+    else
+    {
+        m_CqRing = mmap(nullptr, m_CqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_Fd, IORING_OFF_CQ_RING);
+        if (m_CqRing == MAP_FAILED)
+        {
+            m_CqRing = nullptr;
+            destroy();
+            return false;
+        }
+    }
+    m_SqesSize = sParams.sq_entries * sizeof(io_uring_sqe);
+    void* sSqes = mmap(nullptr, m_SqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_Fd, IORING_OFF_SQES);
+    if (sSqes == MAP_FAILED)
+    {
+        destroy();
+        return false;
+    }
+    m_Sqes = static_cast<io_uring_sqe*>(sSqes);
+
+    char* sSq = static_cast<char*>(m_SqRing);
+    m_SqHead = reinterpret_cast<unsigned*>(sSq + sParams.sq_off.head);
+    m_SqTail = reinterpret_cast<unsigned*>(sSq + sParams.sq_off.tail);
+    m_SqMask = *reinterpret_cast<unsigned*>(sSq + sParams.sq_off.ring_mask);
+    m_SqArray = reinterpret_cast<unsigned*>(sSq + sParams.sq_off.array);
+    m_SqLocalTail = *m_SqTail;
+    char* sCq = static_cast<char*>(m_CqRing);
+    m_CqHead = reinterpret_cast<unsigned*>(sCq + sParams.cq_off.head);
+    m_CqTail = reinterpret_cast<unsigned*>(sCq + sParams.cq_off.tail);
+    m_CqMask = *reinterpret_cast<unsigned*>(sCq + sParams.cq_off.ring_mask);
+    m_Cqes = reinterpret_cast<io_uring_cqe*>(sCq + sParams.cq_off.cqes);
+    return true;
+}
+
+inline void IoUring::destroy()
+{
+    if (m_Sqes != nullptr)
+        munmap(m_Sqes, m_SqesSize);
+    if (m_CqRing != nullptr && m_CqRing != m_SqRing)
+        munmap(m_CqRing, m_CqRingSize);
+    if (m_SqRing != nullptr)
+        munmap(m_SqRing, m_SqRingSize);
+    if (m_Fd >= 0)
+        close(m_Fd);
+    m_Sqes = nullptr;
+    m_CqRing = m_SqRing = nullptr;
+    m_Fd = -1;
+    m_Entries = m_Prepared = 0;
+    m_Inflight = 0;
+    m_Buffer = nullptr;
+    m_BufferSize = 0;
+}
+
+inline bool IoUring::registerBuffer(void* aData, size_t aSize)
+{
+    iovec sVec;
+    sVec.iov_base = aData;
+    sVec.iov_len = aSize;
+    if (syscall(__NR_io_uring_register, m_Fd, IORING_REGISTER_BUFFERS, &sVec, 1) != 0)
+        return false;
+    m_Buffer = static_cast<char*>(aData);
+    m_BufferSize = aSize;
+    return true;
+}
+
+inline bool IoUring::prepareRead(int aFd, void* aBuf, size_t aSize, uint64_t aOffset, uint64_t aUserData)
+{
+    if (m_Inflight + m_Prepared >= m_Entries)
+        return false;
+    unsigned sIndex = m_SqLocalTail++ & m_SqMask;
+    io_uring_sqe& sSqe = m_Sqes[sIndex];
+    memset(&sSqe, 0, sizeof(sSqe));
+    char* sBuf = static_cast<char*>(aBuf);
+    bool sFixed = sBuf >= m_Buffer && sBuf + aSize <= m_Buffer + m_BufferSize;
+    sSqe.opcode = sFixed ? IORING_OP_READ_FIXED : IORING_OP_READ;
+    sSqe.fd = aFd;
+    sSqe.off = aOffset;
+    sSqe.addr = reinterpret_cast<uint64_t>(aBuf);
+    sSqe.len = aSize;
+    sSqe.buf_index = 0;
+    sSqe.user_data = aUserData;
+    m_SqArray[sIndex] = sIndex;
+    ++m_Prepared;
+    return true;
+}
+
+inline void IoUring::submit(unsigned aWaitCount)
+{
+    __atomic_store_n(m_SqTail, m_SqLocalTail, __ATOMIC_RELEASE);
+    unsigned sToSubmit = m_Prepared;
+    while (sToSubmit != 0 || aWaitCount != 0)
+    {
+        unsigned sFlags = aWaitCount != 0 ? IORING_ENTER_GETEVENTS : 0;
+        int rc = syscall(__NR_io_uring_enter, m_Fd, sToSubmit, aWaitCount, sFlags, nullptr, 0);
+        if (rc < 0)
+        {
+            if (errno == EINTR || errno == EAGAIN || errno == EBUSY)
+                continue;
+            throw std::runtime_error("Failed to io_uring_enter");
+        }
+        m_Inflight += rc;
+        m_Prepared -= rc;
+        sToSubmit -= rc;
+        aWaitCount = 0;
+    }
+}
+
+inline bool IoUring::complete(uint64_t& aUserData, int& aResult)
+{
+    unsigned sHead = *m_CqHead;
+    if (sHead == __atomic_load_n(m_CqTail, __ATOMIC_ACQUIRE))
+        return false;
+    const io_uring_cqe& sCqe = m_Cqes[sHead & m_CqMask];
+    aUserData = sCqe.user_data;
+    aResult = sCqe.res;
+    __atomic_store_n(m_CqHead, sHead + 1, __ATOMIC_RELEASE);
+    --m_Inflight;
+    return true;
+}
+
+#else
+
+inline bool IoUring::create(unsigned) { return false; }
+inline void IoUring::destroy() { }
+inline bool IoUring::registerBuffer(void*, size_t) { return false; }
+inline bool IoUring::prepareRead(int, void*, size_t, uint64_t, uint64_t) { return false; }
+inline void IoUring::submit(unsigned) { }
+inline bool IoUring::complete(uint64_t&, int&) { return false; }
+
+#endif
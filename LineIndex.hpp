@@ -0,0 +1,422 @@
+#pragma once
+
+#include <FileReader.hpp>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// Line boundaries of a file: the start of every aStep-th line. A line is
+// found from the nearest sample by counting at most aStep - 1 newlines.
+// The samples are delta coded as varints, in blocks of 64 with the first
+// offset of each block stored as is, so any sample is decoded from its block
+// only.
+//
+// The index may be kept in a sidecar file: update() maps it if it matches
+// the file, scans only the part appended after it and writes it back. The
+// sidecar matches if all its samples decode in order, the file is not
+// shorter and the end of the indexed part hashes the same; otherwise the
+// file is indexed from scratch.
+template <size_t PAGE_SIZE>
+class LineIndex
+{
+public:
+    static constexpr size_t npos = SIZE_MAX;
+    static constexpr size_t BLOCK = 64;
+
+    struct Stats
+    {
+        size_t m_Loaded = 0;  // Bytes indexed by the sidecar.
+        size_t m_Scanned = 0; // Bytes scanned by update().
+    };
+
+    // aSidecar empty - in memory only.
+    LineIndex(size_t aStep = 1024, const std::string& aSidecar = std::string());
+    ~LineIndex() { unmap(); }
+    LineIndex(const LineIndex&) = delete;
+    LineIndex& operator=(const LineIndex&) = delete;
+
+    // Indexes the file up to its end, loading and saving the sidecar.
+    void update(FileReader<PAGE_SIZE>& aReader);
+    // Indexes the next bytes of the file, the ones at size(): lets a scan
+    // of the file build the index on the way.
+    void add(std::string_view aText);
+
+    // Bytes indexed.
+    size_t size() const { return m_Header.m_Size; }
+    // Newlines in them: the last line is lines(), maybe not terminated yet.
+    size_t lines() const { return m_Header.m_Lines; }
+    // Offset of the start of line aLine (from 0), npos if beyond lines().
+    size_t lineOffset(FileReader<PAGE_SIZE>& aReader, size_t aLine) const;
+    // Number and start of the line aOffset is in, up to size().
+    std::pair<size_t, size_t> lineAt(FileReader<PAGE_SIZE>& aReader, size_t aOffset) const;
+    size_t memory() const { return blockCount() * sizeof(Block) + m_Header.m_StreamSize; }
+    const Stats& getStats() const { return m_Stats; }
+
+private:
+    static constexpr size_t TAIL = 4096;
+
+    struct Header
+    {
+        char m_Magic[8] = {'B', 'L', 'I', 'N', 'D', 'E', 'X', '1'};
+        uint64_t m_Step = 0;
+        uint64_t m_Size = 0;
+        uint64_t m_Lines = 0;
+        uint64_t m_Samples = 0;
+        uint64_t m_LastSample = 0;
+        uint64_t m_StreamSize = 0;
+        uint64_t m_TailHash = 0;
+    };
+    struct Block
+    {
+        uint64_t m_Offset;    // Of the first sample.
+        uint64_t m_StreamPos; // Of the deltas of the rest.
+    };
+
+    size_t blockCount() const { return (m_Header.m_Samples + BLOCK - 1) / BLOCK; }
+    const Block* blocks() const { return m_Map != nullptr ? m_MapBlocks : m_Blocks.data(); }
+    const uint8_t* stream() const { return m_Map != nullptr ? m_MapStream : m_Stream.data(); }
+    size_t sampleOffset(size_t aSample) const;
+    void addSample(size_t aOffset);
+    void reset();
+    void own();
+    bool load(FileReader<PAGE_SIZE>& aReader);
+    static bool valid(const Header& aHeader, const Block* aBlocks, const uint8_t* aStream);
+    void save();
+    uint64_t tailHash(FileReader<PAGE_SIZE>& aReader, size_t aSize) const;
+    void unmap();
+
+    std::string m_Sidecar;
+    Header m_Header;
+    std::vector<Block> m_Blocks;
+    std::vector<uint8_t> m_Stream;
+    const char* m_Map = nullptr; // The sidecar, until the index changes.
+    size_t m_MapSize = 0;
+    const Block* m_MapBlocks = nullptr;
+    const uint8_t* m_MapStream = nullptr;
+    bool m_Tried = false; // To load the sidecar.
+    bool m_Saved = false; // The sidecar is up to date.
+    Stats m_Stats;
+};
+
+template <size_t PAGE_SIZE>
+inline LineIndex<PAGE_SIZE>::LineIndex(size_t aStep, const std::string& aSidecar) : m_Sidecar(aSidecar)
+{
+    if (aStep == 0)
+        throw std::runtime_error("Bad line index step");
+    m_Header.m_Step = aStep;
+    reset();
+}
+
+template <size_t PAGE_SIZE>
+inline void LineIndex<PAGE_SIZE>::reset()
+{
+    unmap();
+    size_t sStep = m_Header.m_Step;
+    m_Header = Header();
+    m_Header.m_Step = sStep;
+    m_Blocks.clear();
+    m_Stream.clear();
+    addSample(0);
+    m_Saved = false;
+}
+
+template <size_t PAGE_SIZE>
+inline void LineIndex<PAGE_SIZE>::update(FileReader<PAGE_SIZE>& aReader)
+{
+    if (!m_Tried && !m_Sidecar.empty())
+    {
+        m_Tried = true;
+        if (load(aReader))
+            m_Stats.m_Loaded = size();
+    }
+    size_t sEnd = aReader.end().pos();
+    if (sEnd < size())
+        reset();
+    for (auto sItr = aReader.at(size()); sItr != aReader.end(); )
+    {
+        std::string_view sSpan = sItr.span();
+        add(sSpan);
+        m_Stats.m_Scanned += sSpan.size();
+        sItr.advance(sSpan.size());
+    }
+    if (!m_Saved && !m_Sidecar.empty())
+    {
+        m_Header.m_TailHash = tailHash(aReader, size());
+        save();
+    }
+}
+
+template <size_t PAGE_SIZE>
+inline void LineIndex<PAGE_SIZE>::add(std::string_view aText)
+{
+    own();
+    const char* sBegin = aText.data();
+    const char* sEnd = sBegin + aText.size();
+    for (const char* p = sBegin; (p = static_cast<const char*>(memchr(p, '\n', sEnd - p))) != nullptr; )
+    {
+        ++p;
+        if (++m_Header.m_Lines % m_Header.m_Step == 0)
+            addSample(m_Header.m_Size + (p - sBegin));
+    }
+    m_Header.m_Size += aText.size();
+    m_Saved = false;
+}
+
+template <size_t PAGE_SIZE>
+inline void LineIndex<PAGE_SIZE>::addSample(size_t aOffset)
+{
+    if (m_Header.m_Samples % BLOCK == 0)
+    {
+        m_Blocks.push_back(Block{aOffset, m_Stream.size()});
+    }
+    else
+    {
+        for (uint64_t sDelta = aOffset - m_Header.m_LastSample; ; sDelta >>= 7)
+        {
+            if (sDelta < 0x80)
+            {
+                m_Stream.push_back(static_cast<uint8_t>(sDelta));
+                break;
+            }
+            m_Stream.push_back(static_cast<uint8_t>(sDelta | 0x80));
+        }
+    }
+    m_Header.m_LastSample = aOffset;
+    m_Header.m_Samples++;
+    m_Header.m_StreamSize = m_Stream.size();
+}
+
+template <size_t PAGE_SIZE>
+inline size_t LineIndex<PAGE_SIZE>::sampleOffset(size_t aSample) const
+{
+    const Block& sBlock = blocks()[aSample / BLOCK];
+    const uint8_t* p = stream() + sBlock.m_StreamPos;
+    size_t sOffset = sBlock.m_Offset;
+    for (size_t i = aSample % BLOCK; i > 0; i--)
+    {
+        uint64_t sDelta = 0;
+        for (size_t sShift = 0; ; sShift += 7)
+        {
+            sDelta |= static_cast<uint64_t>(*p & 0x7f) << sShift;
+            if ((*p++ & 0x80) == 0)
+                break;
+        }
+        sOffset += sDelta;
+    }
+    return sOffset;
+}
+
+template <size_t PAGE_SIZE>
+inline size_t LineIndex<PAGE_SIZE>::lineOffset(FileReader<PAGE_SIZE>& aReader, size_t aLine) const
+{
+    if (aLine > lines())
+        return npos;
+    size_t sLeft = aLine % m_Header.m_Step;
+    size_t sOffset = sampleOffset(aLine / m_Header.m_Step);
+    for (auto sItr = aReader.at(sOffset); sLeft != 0 && sItr != aReader.end(); )
+    {
+        std::string_view sSpan = sItr.span();
+        const char* sEnd = sSpan.data() + sSpan.size();
+        for (const char* p = sSpan.data(); (p = static_cast<const char*>(memchr(p, '\n', sEnd - p))) != nullptr; )
+        {
+            ++p;
+            if (--sLeft == 0)
+                return sItr.pos() + (p - sSpan.data());
+        }
+        sItr.advance(sSpan.size());
+    }
+    return sLeft == 0 ? sOffset : npos;
+}
+
+// The last block starting not after aOffset, its last sample not after it,
+// then the newlines from that sample.
+template <size_t PAGE_SIZE>
+inline std::pair<size_t, size_t> LineIndex<PAGE_SIZE>::lineAt(FileReader<PAGE_SIZE>& aReader, size_t aOffset) const
+{
+    aOffset = std::min(aOffset, size());
+    const Block* sBlocks = blocks();
+    size_t sBlock = std::upper_bound(sBlocks, sBlocks + blockCount(), aOffset,
+                                     [](size_t aValue, const Block& aBlock) { return aValue < aBlock.m_Offset; }) - sBlocks - 1;
+    size_t sSample = sBlock * BLOCK;
+    size_t sOffset = sBlocks[sBlock].m_Offset;
+    const uint8_t* p = stream() + sBlocks[sBlock].m_StreamPos;
+    while (sSample + 1 < m_Header.m_Samples && (sSample + 1) % BLOCK != 0)
+    {
+        uint64_t sDelta = 0;
+        for (size_t sShift = 0; ; sShift += 7)
+        {
+            sDelta |= static_cast<uint64_t>(*p & 0x7f) << sShift;
+            if ((*p++ & 0x80) == 0)
+                break;
+        }
+        if (sOffset + sDelta > aOffset)
+            break;
+        sOffset += sDelta;
+        sSample++;
+    }
+
+    size_t sLine = sSample * m_Header.m_Step;
+    size_t sStart = sOffset;
+    for (auto sItr = aReader.at(sOffset); sItr.pos() < aOffset; )
+    {
+        std::string_view sSpan = sItr.span().substr(0, aOffset - sItr.pos());
+        const char* sEnd = sSpan.data() + sSpan.size();
+        for (const char* q = sSpan.data(); (q = static_cast<const char*>(memchr(q, '\n', sEnd - q))) != nullptr; )
+        {
+            ++q;
+            sLine++;
+            sStart = sItr.pos() + (q - sSpan.data());
+        }
+        sItr.advance(sSpan.size());
+    }
+    return std::pair<size_t, size_t>(sLine, sStart);
+}
+
+// FNV-1a of the last TAIL bytes before aSize.
+template <size_t PAGE_SIZE>
+inline uint64_t LineIndex<PAGE_SIZE>::tailHash(FileReader<PAGE_SIZE>& aReader, size_t aSize) const
+{
+    uint64_t sHash = 0xcbf29ce484222325ull;
+    size_t sBegin = aSize - std::min(aSize, TAIL);
+    for (auto sItr = aReader.at(sBegin); sItr.pos() < aSize; )
+    {
+        std::string_view sSpan = sItr.span().substr(0, aSize - sItr.pos());
+        for (char c : sSpan)
+            sHash = (sHash ^ static_cast<unsigned char>(c)) * 0x100000001b3ull;
+        sItr.advance(sSpan.size());
+    }
+    return sHash;
+}
+
+// Copies the mapped sidecar to own memory before the index changes.
+template <size_t PAGE_SIZE>
+inline void LineIndex<PAGE_SIZE>::own()
+{
+    if (m_Map == nullptr)
+        return;
+    m_Blocks.assign(m_MapBlocks, m_MapBlocks + blockCount());
+    m_Stream.assign(m_MapStream, m_MapStream + m_Header.m_StreamSize);
+    unmap();
+}
+
+template <size_t PAGE_SIZE>
+inline void LineIndex<PAGE_SIZE>::unmap()
+{
+    if (m_Map != nullptr)
+        munmap(const_cast<char*>(m_Map), m_MapSize);
+    m_Map = nullptr;
+    m_MapBlocks = nullptr;
+    m_MapStream = nullptr;
+}
+
+// A missing or broken sidecar, or one of another step or file, is ignored.
+template <size_t PAGE_SIZE>
+inline bool LineIndex<PAGE_SIZE>::load(FileReader<PAGE_SIZE>& aReader)
+{
+    int sFd = open(m_Sidecar.c_str(), O_RDONLY | O_CLOEXEC);
+    if (sFd < 0)
+        return false;
+    struct stat st;
+    const char* sMap = nullptr;
+    if (fstat(sFd, &st) == 0 && static_cast<size_t>(st.st_size) >= sizeof(Header))
+    {
+        void* sAddr = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, sFd, 0);
+        if (sAddr != MAP_FAILED)
+            sMap = static_cast<const char*>(sAddr);
+    }
+    close(sFd);
+    if (sMap == nullptr)
+        return false;
+
+    Header sHeader;
+    memcpy(&sHeader, sMap, sizeof(Header));
+    size_t sBlocks = (sHeader.m_Samples + BLOCK - 1) / BLOCK;
+    if (memcmp(sHeader.m_Magic, Header().m_Magic, sizeof(sHeader.m_Magic)) != 0 || sHeader.m_Step != m_Header.m_Step ||
+        sHeader.m_Size > aReader.end().pos() || sHeader.m_Samples == 0 || sHeader.m_Samples > sHeader.m_Size + 1 ||
+        sHeader.m_StreamSize > static_cast<size_t>(st.st_size) ||
+        sizeof(Header) + sBlocks * sizeof(Block) + sHeader.m_StreamSize != static_cast<size_t>(st.st_size) ||
+        !valid(sHeader, reinterpret_cast<const Block*>(sMap + sizeof(Header)),
+               reinterpret_cast<const uint8_t*>(sMap + sizeof(Header) + sBlocks * sizeof(Block))) ||
+        tailHash(aReader, sHeader.m_Size) != sHeader.m_TailHash)
+    {
+        munmap(const_cast<char*>(sMap), st.st_size);
+        return false;
+    }
+    unmap();
+    m_Header = sHeader;
+    m_Blocks.clear();
+    m_Stream.clear();
+    m_Map = sMap;
+    m_MapSize = st.st_size;
+    m_MapBlocks = reinterpret_cast<const Block*>(sMap + sizeof(Header));
+    m_MapStream = reinterpret_cast<const uint8_t*>(sMap + sizeof(Header) + sBlocks * sizeof(Block));
+    m_Saved = true;
+    return true;
+}
+
+// Decodes all the samples: each block starts at the end of the deltas of the
+// previous one and the samples grow from 0 to the last one, within the file.
+template <size_t PAGE_SIZE>
+inline bool LineIndex<PAGE_SIZE>::valid(const Header& aHeader, const Block* aBlocks, const uint8_t* aStream)
+{
+    const uint8_t* p = aStream;
+    const uint8_t* sEnd = aStream + aHeader.m_StreamSize;
+    size_t sOffset = 0;
+    for (size_t i = 0; i < aHeader.m_Samples; i++)
+    {
+        if (i % BLOCK == 0)
+        {
+            const Block& sBlock = aBlocks[i / BLOCK];
+            if (sBlock.m_Offset < sOffset || sBlock.m_Offset > aHeader.m_Size || (i == 0 && sBlock.m_Offset != 0) ||
+                sBlock.m_StreamPos != static_cast<size_t>(p - aStream))
+                return false;
+            sOffset = sBlock.m_Offset;
+            continue;
+        }
+        uint64_t sDelta = 0;
+        for (size_t sShift = 0; ; sShift += 7)
+        {
+            if (p == sEnd || sShift > 63)
+                return false;
+            sDelta |= static_cast<uint64_t>(*p & 0x7f) << sShift;
+            if ((*p++ & 0x80) == 0)
+                break;
+        }
+        if (sDelta > aHeader.m_Size - sOffset)
+            return false;
+        sOffset += sDelta;
+    }
+    return p == sEnd && sOffset == aHeader.m_LastSample;
+}
+
+// Written aside and renamed, so a reader never maps a partial sidecar.
+template <size_t PAGE_SIZE>
+inline void LineIndex<PAGE_SIZE>::save()
+{
+    std::string sTemp = m_Sidecar + ".tmp";
+    FILE* f = fopen(sTemp.c_str(), "wb");
+    if (f == nullptr)
+        throw std::runtime_error("Failed to create line index");
+    bool sOk = fwrite(&m_Header, sizeof(Header), 1, f) == 1;
+    sOk = sOk && fwrite(blocks(), sizeof(Block), blockCount(), f) == blockCount();
+    sOk = sOk && fwrite(stream(), 1, m_Header.m_StreamSize, f) == m_Header.m_StreamSize;
+    sOk = fclose(f) == 0 && sOk;
+    if (!sOk || rename(sTemp.c_str(), m_Sidecar.c_str()) != 0)
+    {
+        remove(sTemp.c_str());
+        throw std::runtime_error("Failed to write line index");
+    }
+    m_Saved = true;
+}
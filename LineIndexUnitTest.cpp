@@ -0,0 +1,245 @@
+#include <LineIndex.hpp>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+const char* filename = "./line_index_test.dat";
+const char* indexname = "./line_index_test.idx";
+
+void check(bool aExpession, const char* aMessage)
+{
+    if (!aExpession)
+    {
+        //assert(false);
+        throw std::runtime_error(aMessage);
+    }
+}
+
+#define CHECK(expr) check(expr, #expr);
+
+struct FileRemover
+{
+    ~FileRemover()
+    {
+        remove(indexname);
+        if (remove(filename) != 0)
+            std::cerr << "Failed to remove file!" << std::endl;
+    }
+};
+
+// Lines of random length, many of them empty, some longer than a page.
+std::string generate(size_t aLines, bool aTerminated)
+{
+    std::string sText;
+    for (size_t i = 0; i < aLines; i++)
+    {
+        size_t sLength = rand() % 4 == 0 ? 0 : rand() % 100 == 0 ? rand() % 300 : rand() % 20;
+        for (size_t j = 0; j < sLength; j++)
+            sText.push_back('a' + rand() % 26);
+        if (i + 1 < aLines || aTerminated)
+            sText.push_back('\n');
+    }
+    return sText;
+}
+
+void write(const std::string& aText, bool aAppend)
+{
+    std::ofstream f(filename, std::ios::binary | (aAppend ? std::ios::app : std::ios::trunc));
+    f << aText;
+}
+
+// Every line start and every offset against the text.
+template <size_t PAGE_SIZE>
+void verify(LineIndex<PAGE_SIZE>& aIndex, FileReader<PAGE_SIZE>& aReader, const std::string& aText)
+{
+    std::vector<size_t> sStarts(1, 0);
+    for (size_t i = 0; i < aText.size(); i++)
+        if (aText[i] == '\n')
+            sStarts.push_back(i + 1);
+
+    CHECK(aIndex.size() == aText.size());
+    CHECK(aIndex.lines() == sStarts.size() - 1);
+    for (size_t i = 0; i < sStarts.size(); i++)
+        CHECK(aIndex.lineOffset(aReader, i) == sStarts[i]);
+    CHECK(aIndex.lineOffset(aReader, sStarts.size()) == aIndex.npos);
+
+    size_t sLine = 0;
+    for (size_t i = 0; i <= aText.size(); i++)
+    {
+        while (sLine + 1 < sStarts.size() && sStarts[sLine + 1] <= i)
+            sLine++;
+        auto sFound = aIndex.lineAt(aReader, i);
+        CHECK(sFound.first == sLine);
+        CHECK(sFound.second == sStarts[sLine]);
+    }
+}
+
+template <size_t PAGE_SIZE>
+void testMemory(size_t aStep, size_t aLines, bool aTerminated)
+{
+    std::string sText = generate(aLines, aTerminated);
+    write(sText, false);
+    FileReader<PAGE_SIZE> fr(filename);
+    LineIndex<PAGE_SIZE> sIndex(aStep);
+    sIndex.update(fr);
+    CHECK(sIndex.getStats().m_Scanned == sText.size());
+    verify(sIndex, fr, sText);
+
+    // Built by a scan.
+    LineIndex<PAGE_SIZE> sScanned(aStep);
+    for (size_t i = 0; i < sText.size(); i += 7)
+        sScanned.add(std::string_view(sText).substr(i, 7));
+    verify(sScanned, fr, sText);
+}
+
+template <size_t PAGE_SIZE>
+void testSidecar(size_t aStep)
+{
+    remove(indexname);
+    std::string sText = generate(2000, true);
+    write(sText, false);
+    {
+        FileReader<PAGE_SIZE> fr(filename);
+        LineIndex<PAGE_SIZE> sIndex(aStep, indexname);
+        sIndex.update(fr);
+        CHECK(sIndex.getStats().m_Loaded == 0);
+        CHECK(sIndex.getStats().m_Scanned == sText.size());
+    }
+
+    // Reused as is.
+    {
+        FileReader<PAGE_SIZE> fr(filename);
+        LineIndex<PAGE_SIZE> sIndex(aStep, indexname);
+        sIndex.update(fr);
+        CHECK(sIndex.getStats().m_Loaded == sText.size());
+        CHECK(sIndex.getStats().m_Scanned == 0);
+        verify(sIndex, fr, sText);
+    }
+
+    // Grown: only the tail is scanned, the unterminated last line continues.
+    std::string sTail = "tail of the last line\n" + generate(1000, false);
+    write(sTail, true);
+    sText += sTail;
+    {
+        FileReader<PAGE_SIZE> fr(filename);
+        LineIndex<PAGE_SIZE> sIndex(aStep, indexname);
+        sIndex.update(fr);
+        CHECK(sIndex.getStats().m_Loaded == sText.size() - sTail.size());
+        CHECK(sIndex.getStats().m_Scanned == sTail.size());
+        verify(sIndex, fr, sText);
+    }
+    {
+        FileReader<PAGE_SIZE> fr(filename);
+        LineIndex<PAGE_SIZE> sIndex(aStep, indexname);
+        sIndex.update(fr);
+        CHECK(sIndex.getStats().m_Scanned == 0);
+        verify(sIndex, fr, sText);
+    }
+
+    // Another step: rebuilt.
+    {
+        FileReader<PAGE_SIZE> fr(filename);
+        LineIndex<PAGE_SIZE> sIndex(aStep + 1, indexname);
+        sIndex.update(fr);
+        CHECK(sIndex.getStats().m_Loaded == 0);
+        verify(sIndex, fr, sText);
+    }
+
+    // Rewritten with the same size and truncated: rebuilt.
+    for (size_t sSize : {sText.size(), sText.size() / 2})
+    {
+        {
+            FileReader<PAGE_SIZE> fr(filename);
+            LineIndex<PAGE_SIZE> sIndex(aStep, indexname);
+            sIndex.update(fr);
+        }
+        sText = generate(sSize, true).substr(0, sSize);
+        write(sText, false);
+        FileReader<PAGE_SIZE> fr(filename);
+        LineIndex<PAGE_SIZE> sIndex(aStep, indexname);
+        sIndex.update(fr);
+        CHECK(sIndex.getStats().m_Loaded == 0);
+        CHECK(sIndex.getStats().m_Scanned == sText.size());
+        verify(sIndex, fr, sText);
+    }
+
+    // Broken: rebuilt, and the rebuilt sidecar is loaded again.
+    std::ifstream sIn(indexname, std::ios::binary);
+    std::string sGood((std::istreambuf_iterator<char>(sIn)), std::istreambuf_iterator<char>());
+    sIn.close();
+    const size_t HEADER = 64;
+    const size_t BLOCK = 16;
+    uint64_t sSamples;
+    memcpy(&sSamples, sGood.data() + 32, sizeof(sSamples));
+    size_t sLastBlock = HEADER + (sSamples - 1) / 64 * BLOCK;
+    std::vector<std::pair<size_t, uint64_t>> sCorruptions = {
+        {HEADER, 5},                     // First block not at 0.
+        {HEADER + 8, 1ull << 40},        // Stream position out of the stream.
+        {sLastBlock, sText.size() + 1},  // Block out of the file.
+        {32, sSamples + 64},             // More samples than blocks.
+    };
+    if (sSamples > 64)
+    {
+        sCorruptions.push_back({sLastBlock, 0});     // Block before the previous one.
+        sCorruptions.push_back({sLastBlock + 8, 0}); // Block over the deltas of another.
+    }
+    for (size_t i = 0; i <= sCorruptions.size(); i++)
+    {
+        std::string sBroken = sGood;
+        if (i < sCorruptions.size())
+            memcpy(&sBroken[sCorruptions[i].first], &sCorruptions[i].second, sizeof(uint64_t));
+        else if (sSamples % 64 != 1)
+            sBroken.back() |= 0x80; // Delta running out of the stream.
+        else
+            sBroken += "garbage";
+        {
+            std::ofstream f(indexname, std::ios::binary | std::ios::trunc);
+            f << sBroken;
+        }
+        FileReader<PAGE_SIZE> fr(filename);
+        {
+            LineIndex<PAGE_SIZE> sIndex(aStep, indexname);
+            sIndex.update(fr);
+            CHECK(sIndex.getStats().m_Loaded == 0);
+            verify(sIndex, fr, sText);
+        }
+        LineIndex<PAGE_SIZE> sIndex(aStep, indexname);
+        sIndex.update(fr);
+        CHECK(sIndex.getStats().m_Loaded == sText.size());
+    }
+}
+
+int main()
+{
+    int rc = EXIT_SUCCESS;
+    FileRemover sRemover;
+
+    try
+    {
+        for (size_t sStep : {1, 2, 3, 64, 300})
+        {
+            testMemory<64>(sStep, 0, false);
+            testMemory<64>(sStep, 1, false);
+            testMemory<64>(sStep, 1, true);
+            testMemory<64>(sStep, 3000, true);
+            testMemory<4096>(sStep, 3000, false);
+        }
+        for (size_t sStep : {1, 5, 200})
+        {
+            testSidecar<64>(sStep);
+            testSidecar<4096>(sStep);
+        }
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << e.what() << std::endl;
+        rc = EXIT_FAILURE;
+    }
+    return rc;
+}
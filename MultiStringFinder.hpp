@@ -0,0 +1,158 @@
+#pragma once
+
+#include <array>
+#include <climits>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+// Aho-Corasick automaton: searches several needles in one pass with the
+// same dense DFA layout as StringFinder. The total length of the needles
+// is limited by std::numeric_limits<SIZE_TYPE>::max().
+template <class SIZE_TYPE = size_t, class CHAR = char>
+class MultiStringFinder
+{
+public:
+    static_assert(std::is_integral_v<CHAR>, "Type expected to be integral");
+
+    // Indexes of the needles that end at the last fed character, longest
+    // first.
+    struct Matches
+    {
+        const uint32_t* m_Begin;
+        const uint32_t* m_End;
+        const uint32_t* begin() const { return m_Begin; }
+        const uint32_t* end() const { return m_End; }
+        size_t size() const { return m_End - m_Begin; }
+        bool empty() const { return m_Begin == m_End; }
+    };
+
+    MultiStringFinder() { create({}); }
+    MultiStringFinder(const std::vector<std::basic_string_view<CHAR>>& aNeedles) { create(aNeedles); }
+    void create(const std::vector<std::basic_string_view<CHAR>>& aNeedles);
+    // Returns true if any needle ends at c, see matches().
+    bool feed(CHAR c);
+    Matches matches() const;
+    size_t needleSize(size_t aIndex) const { return m_Sizes[aIndex]; }
+    size_t needleCount() const { return m_Sizes.size(); }
+    void restart() { m_CurPos = 0; }
+
+private:
+    using arr_t = std::array<SIZE_TYPE, 1ull << (sizeof(CHAR) * CHAR_BIT)>;
+
+    static size_t cast(CHAR c) { return static_cast<size_t>(static_cast< std::make_unsigned_t<CHAR> >(c)); }
+
+    // States that complete a needle are numbered last, from m_FinPos on.
+    std::vector<arr_t> m_Index;
+    SIZE_TYPE m_CurPos;
+    SIZE_TYPE m_FinPos;
+    // Needles of final state m_FinPos + i: m_Matches[m_MatchPos[i]..m_MatchPos[i + 1]).
+    std::vector<uint32_t> m_MatchPos;
+    std::vector<uint32_t> m_Matches;
+    std::vector<size_t> m_Sizes;
+};
+
+template <typename SIZE_TYPE, typename CHAR>
+inline void MultiStringFinder<SIZE_TYPE, CHAR>::create(const std::vector<std::basic_string_view<CHAR>>& aNeedles)
+{
+    for (std::basic_string_view<CHAR> sNeedle : aNeedles)
+    {
+        if (sNeedle.size() == 0)
+            throw std::runtime_error("Cannot search an empty string");
+    }
+    if (aNeedles.size() > std::numeric_limits<uint32_t>::max())
+        throw std::runtime_error("Too many search strings");
+
+    // Trie, 0 is the root and means "no edge" since nothing leads to it.
+    std::vector<arr_t> sTrie(1, arr_t{});
+    std::vector<std::vector<uint32_t>> sOut(1);
+    m_Sizes.clear();
+    for (size_t i = 0; i < aNeedles.size(); i++)
+    {
+        size_t sState = 0;
+        for (CHAR c : aNeedles[i])
+        {
+            size_t u = cast(c);
+            if (sTrie[sState][u] == 0)
+            {
+                if (sTrie.size() > static_cast<size_t>(std::numeric_limits<SIZE_TYPE>::max()))
+                    throw std::runtime_error("Search strings are too big");
+                sTrie[sState][u] = sTrie.size();
+                sTrie.emplace_back();
+                sOut.emplace_back();
+            }
+            sState = sTrie[sState][u];
+        }
+        sOut[sState].push_back(i);
+        m_Sizes.push_back(aNeedles[i].size());
+    }
+
+    // Breadth first: the fallback of a state is shallower, so its edges are
+    // complete by the time they are copied. Edges missing in the trie lead
+    // where they lead from the fallback, the same as StringFinder's m_RepPos.
+    std::vector<size_t> sOrder(1, 0);
+    std::vector<size_t> sFail(sTrie.size(), 0);
+    sOrder.reserve(sTrie.size());
+    for (size_t i = 0; i < sOrder.size(); i++)
+    {
+        size_t sState = sOrder[i];
+        if (sState != 0)
+            sOut[sState].insert(sOut[sState].end(), sOut[sFail[sState]].begin(), sOut[sFail[sState]].end());
+        for (size_t u = 0; u < sTrie[sState].size(); u++)
+        {
+            size_t sNext = sTrie[sState][u];
+            if (sNext != 0)
+            {
+                sFail[sNext] = sState == 0 ? 0 : sTrie[sFail[sState]][u];
+                sOrder.push_back(sNext);
+            }
+            else
+            {
+                sTrie[sState][u] = sState == 0 ? 0 : sTrie[sFail[sState]][u];
+            }
+        }
+    }
+
+    // Renumber so that feed() tells a match by a single comparison.
+    std::vector<SIZE_TYPE> sNew(sTrie.size());
+    size_t sNext = 0;
+    for (size_t sState : sOrder)
+        if (sOut[sState].empty())
+            sNew[sState] = sNext++;
+    m_FinPos = sNext;
+    m_MatchPos.assign(1, 0);
+    m_Matches.clear();
+    for (size_t sState : sOrder)
+    {
+        if (!sOut[sState].empty())
+        {
+            sNew[sState] = sNext++;
+            m_Matches.insert(m_Matches.end(), sOut[sState].begin(), sOut[sState].end());
+            m_MatchPos.push_back(m_Matches.size());
+        }
+    }
+    m_Index.resize(sTrie.size());
+    for (size_t sState = 0; sState < sTrie.size(); sState++)
+        for (size_t u = 0; u < sTrie[sState].size(); u++)
+            m_Index[sNew[sState]][u] = sNew[sTrie[sState][u]];
+    m_CurPos = 0;
+}
+
+template <typename SIZE_TYPE, typename CHAR>
+inline bool MultiStringFinder<SIZE_TYPE, CHAR>::feed(CHAR c)
+{
+    m_CurPos = m_Index[m_CurPos][cast(c)];
+    return m_CurPos >= m_FinPos;
+}
+
+template <typename SIZE_TYPE, typename CHAR>
+inline typename MultiStringFinder<SIZE_TYPE, CHAR>::Matches MultiStringFinder<SIZE_TYPE, CHAR>::matches() const
+{
+    if (m_CurPos < m_FinPos)
+        return Matches{nullptr, nullptr};
+    size_t sFinal = m_CurPos - m_FinPos;
+    return Matches{m_Matches.data() + m_MatchPos[sFinal], m_Matches.data() + m_MatchPos[sFinal + 1]};
+}
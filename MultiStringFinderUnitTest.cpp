@@ -0,0 +1,193 @@
+#include <MultiStringFinder.hpp>
+
+#include <algorithm>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+void check(bool aExpession, const char* aMessage)
+{
+    if (!aExpession)
+    {
+        //assert(false);
+        throw std::runtime_error(aMessage);
+    }
+}
+
+#define CHECK(expr) check(expr, #expr);
+
+template <class T>
+const char* var() { return "(? ? ?)"; }
+
+template<>
+const char* var<unsigned char>() { return " (uchar)"; }
+template<>
+const char* var<short>() { return " (short)"; }
+template<>
+const char* var<unsigned>() { return " (unsigned)"; }
+template<>
+const char* var<size_t>() { return " (size_t)"; }
+
+using Match = std::pair<size_t, size_t>; // Start position, needle index.
+std::vector<Match> a; // MultiStringFinder
+std::vector<Match> b; // Reference;
+int rc = EXIT_SUCCESS;
+
+template <class SIZE_TYPE>
+void calc_a(const std::vector<std::string_view>& aNeedles, std::string_view aHayStack)
+{
+    a.clear();
+    MultiStringFinder<SIZE_TYPE> cf(aNeedles);
+    size_t sLongest = SIZE_MAX;
+    for (size_t i = 0; i < aHayStack.size(); i++)
+    {
+        if (!cf.feed(aHayStack[i]))
+        {
+            CHECK(cf.matches().empty());
+            continue;
+        }
+        CHECK(!cf.matches().empty());
+        sLongest = SIZE_MAX;
+        for (uint32_t n : cf.matches())
+        {
+            CHECK(cf.needleSize(n) <= sLongest);
+            sLongest = cf.needleSize(n);
+            a.emplace_back(i + 1 - cf.needleSize(n), n);
+        }
+    }
+    std::sort(a.begin(), a.end());
+}
+
+void calc_b(const std::vector<std::string_view>& aNeedles, std::string_view aHayStack)
+{
+    b.clear();
+    for (size_t n = 0; n < aNeedles.size(); n++)
+    {
+        size_t pos = SIZE_MAX;
+        while (true)
+        {
+            pos = aHayStack.find(aNeedles[n], pos + 1);
+            if (pos == aHayStack.npos)
+                break;
+            b.emplace_back(pos, n);
+        }
+    }
+    std::sort(b.begin(), b.end());
+}
+
+template <class SIZE_TYPE>
+void compare(const std::vector<std::string_view>& aNeedles, std::string_view aHayStack)
+{
+    calc_a<SIZE_TYPE>(aNeedles, aHayStack);
+    calc_b(aNeedles, aHayStack);
+    if (a != b)
+    {
+        std::cout << "Wrong search of";
+        for (std::string_view sNeedle : aNeedles)
+            std::cout << " \"" << sNeedle << "\"";
+        std::cout << " in \"" << aHayStack << "\" " << var<SIZE_TYPE>() << "\n";
+        std::cout << "Found:    ";
+        for (size_t i = 0; i < a.size(); i++)
+            std::cout << (i ? ", " : "") << a[i].first << ":" << a[i].second;
+        std::cout << "\n";
+        std::cout << "Expected: ";
+        for (size_t i = 0; i < b.size(); i++)
+            std::cout << (i ? ", " : "") << b[i].first << ":" << b[i].second;
+        std::cout << "\n";
+        rc = EXIT_FAILURE;
+    }
+}
+
+template <class SIZE_TYPE>
+void simple_test()
+{
+    compare<SIZE_TYPE>({}, "ababab");
+    compare<SIZE_TYPE>({"aba"}, "ababab");
+    compare<SIZE_TYPE>({"he", "she", "his", "hers"}, "ushers said his sheriff");
+    compare<SIZE_TYPE>({"a", "aa", "aaa"}, "aaaaabaa");
+    compare<SIZE_TYPE>({"abc", "abc", "bc"}, "xabcabc");
+    compare<SIZE_TYPE>({"abcabd", "cab", "bdab"}, "abcabcabdabd");
+    compare<SIZE_TYPE>({"ab", "cd"}, "efefef");
+    compare<SIZE_TYPE>({"abc"}, "ab");
+    compare<SIZE_TYPE>({"user banned", "banned", "timeout", "id=1"}, "user banned id=12 timeout banned");
+    {
+        constexpr size_t S = std::min(size_t(std::numeric_limits<SIZE_TYPE>::max()) / 2, size_t(4 * 1024));
+        std::string s1(S, 'a');
+        std::string s2(S, 'b');
+        compare<SIZE_TYPE>({s1, s2}, s1 + s2);
+    }
+    {
+        constexpr size_t S = size_t(std::numeric_limits<SIZE_TYPE>::max());
+        if (S < 64 * 1024)
+        {
+            std::string s1(S, 'a');
+            std::string s2(1, 'b');
+            bool sThrown = false;
+            try
+            {
+                MultiStringFinder<SIZE_TYPE> cf({s1, s2});
+            }
+            catch (const std::runtime_error&)
+            {
+                sThrown = true;
+            }
+            CHECK(sThrown);
+        }
+    }
+}
+
+template <class SIZE_TYPE>
+void massive_test()
+{
+    const size_t ALPH = 8;
+    const size_t ROUNDS = 512;
+    std::vector<std::string> needles;
+    std::string haystack;
+    auto gen = [](std::string& s, size_t l, size_t al)
+    {
+        s.clear();
+        for (size_t i = 0; i < l; i++)
+        {
+            s += static_cast<char>(0 - rand() % al);
+        }
+    };
+    for (size_t i = 0; i < ROUNDS; i++)
+    {
+        for (size_t al = 2; al <= ALPH; al++)
+        {
+            needles.resize(1 + rand() % 6);
+            for (std::string& needle : needles)
+                gen(needle, 1 + rand() % 4, al);
+            gen(haystack, rand() % 128, al);
+            compare<SIZE_TYPE>(std::vector<std::string_view>(needles.begin(), needles.end()), haystack);
+        }
+    }
+}
+
+template <class SIZE_TYPE>
+void test()
+{
+    simple_test<SIZE_TYPE>();
+    massive_test<SIZE_TYPE>();
+}
+
+int main()
+{
+
+    try
+    {
+        test<size_t>();
+        test<unsigned char>();
+        test<short>();
+        test<unsigned>();
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << e.what() << std::endl;
+        rc = EXIT_FAILURE;
+    }
+    if (rc == EXIT_SUCCESS)
+        std::cout << "Well done" << std::endl;
+    return rc;
+}
@@ -0,0 +1,117 @@
+#pragma once
+
+#include <FileReader.hpp>
+#include <StringFinder.hpp>
+
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <exception>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+// Searches a file for a needle with several threads. The file is split into
+// page aligned ranges, each thread scans its range with its own FileReader
+// and StringFinder. A thread owns the matches that start in its range and
+// reads (needle size - 1) bytes past it, so the matches that cross the
+// border are found exactly once, by the thread they start in.
+template <size_t PAGE_SIZE, class SIZE_TYPE = size_t>
+class ParallelFinder
+{
+public:
+    using Options = typename FileReader<PAGE_SIZE>::Options;
+
+    ParallelFinder(std::string_view aNeedle) : m_Needle(aNeedle), m_Finder(aNeedle) {}
+
+    // Sorted offsets of all the matches in the file. 0 threads - one per
+    // hardware thread.
+    std::vector<size_t> find(const std::string& aFileName, size_t aThreads = 0, const Options& aOptions = Options()) const;
+
+private:
+    void findRange(const std::string& aFileName, const Options& aOptions, size_t aBegin, size_t aEnd,
+                   std::vector<size_t>& aMatches) const;
+
+    std::string m_Needle;
+    StringFinder<SIZE_TYPE> m_Finder; // Copied to every thread in the initial state.
+};
+
+template <size_t PAGE_SIZE, class SIZE_TYPE>
+inline std::vector<size_t> ParallelFinder<PAGE_SIZE, SIZE_TYPE>::find(const std::string& aFileName, size_t aThreads,
+                                                                     const Options& aOptions) const
+{
+    struct stat st;
+    if (stat(aFileName.c_str(), &st) != 0)
+        throw std::runtime_error("Failed to open file");
+    size_t sSize = st.st_size;
+    if (aThreads == 0)
+        aThreads = std::max(1u, std::thread::hardware_concurrency());
+
+    size_t sPages = (sSize + PAGE_SIZE - 1) / PAGE_SIZE;
+    size_t sRange = std::max<size_t>(1, (sPages + aThreads - 1) / aThreads) * PAGE_SIZE;
+    size_t sCount = std::max<size_t>(1, (sSize + sRange - 1) / sRange);
+
+    std::vector<std::vector<size_t>> sMatches(sCount);
+    std::vector<std::exception_ptr> sErrors(sCount);
+    std::vector<std::thread> sThreads;
+    for (size_t i = 1; i < sCount; i++)
+    {
+        sThreads.emplace_back([&, i]()
+        {
+            try
+            {
+                findRange(aFileName, aOptions, i * sRange, std::min(sSize, (i + 1) * sRange), sMatches[i]);
+            }
+            catch (...)
+            {
+                sErrors[i] = std::current_exception();
+            }
+        });
+    }
+    try
+    {
+        findRange(aFileName, aOptions, 0, std::min(sSize, sRange), sMatches[0]);
+    }
+    catch (...)
+    {
+        sErrors[0] = std::current_exception();
+    }
+    for (std::thread& sThread : sThreads)
+        sThread.join();
+    for (std::exception_ptr& sError : sErrors)
+    {
+        if (sError)
+            std::rethrow_exception(sError);
+    }
+
+    std::vector<size_t> sResult;
+    for (std::vector<size_t>& sRangeMatches : sMatches)
+        sResult.insert(sResult.end(), sRangeMatches.begin(), sRangeMatches.end());
+    return sResult;
+}
+
+// Starts in the initial state, so no match that begins before aBegin can
+// complete; the overlap is too short for one that begins at aEnd or later.
+template <size_t PAGE_SIZE, class SIZE_TYPE>
+inline void ParallelFinder<PAGE_SIZE, SIZE_TYPE>::findRange(const std::string& aFileName, const Options& aOptions,
+                                                           size_t aBegin, size_t aEnd,
+                                                           std::vector<size_t>& aMatches) const
+{
+    FileReader<PAGE_SIZE> fr(aFileName, aOptions);
+    size_t sEnd = std::min(fr.end().pos(), aEnd + m_Needle.size() - 1);
+    StringFinder<SIZE_TYPE> sFinder = m_Finder;
+    std::vector<size_t> sEnds;
+    for (auto sItr = fr.at(aBegin); sItr.pos() < sEnd; )
+    {
+        std::string_view sSpan = sItr.span().substr(0, sEnd - sItr.pos());
+        sEnds.clear();
+        sFinder.feed(sSpan.data(), sSpan.data() + sSpan.size(), std::back_inserter(sEnds));
+        for (size_t sMatchEnd : sEnds)
+            aMatches.push_back(sItr.pos() + sMatchEnd - m_Needle.size());
+        sItr.advance(sSpan.size());
+    }
+}
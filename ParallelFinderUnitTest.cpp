@@ -0,0 +1,115 @@
+#include <ParallelFinder.hpp>
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+
+const char* filename = "./parallel.dat";
+
+void check(bool aExpession, const char* aMessage)
+{
+    if (!aExpession)
+    {
+        //assert(false);
+        throw std::runtime_error(aMessage);
+    }
+}
+
+#define CHECK(expr) check(expr, #expr);
+
+struct FileRemover
+{
+    ~FileRemover()
+    {
+        if (remove(filename) != 0)
+            std::cerr << "Failed to remove file!" << std::endl;
+    }
+};
+
+void writeFile(const std::string& aData)
+{
+    std::ofstream f(filename, std::fstream::out | std::fstream::trunc | std::fstream::binary);
+    f.write(aData.data(), aData.size());
+    CHECK(f.good());
+}
+
+std::vector<size_t> reference(std::string_view aNeedle, std::string_view aHayStack)
+{
+    std::vector<size_t> sResult;
+    for (size_t pos = aHayStack.find(aNeedle); pos != aHayStack.npos; pos = aHayStack.find(aNeedle, pos + 1))
+        sResult.push_back(pos);
+    return sResult;
+}
+
+template <size_t PAGE_SIZE, class SIZE_TYPE>
+void compare(std::string_view aNeedle, const std::string& aData, size_t aThreads)
+{
+    ParallelFinder<PAGE_SIZE, SIZE_TYPE> sFinder(aNeedle);
+    typename FileReader<PAGE_SIZE>::Options sOptions;
+    sOptions.m_ReadaheadPages = aThreads % 3;
+    if (sFinder.find(filename, aThreads, sOptions) != reference(aNeedle, aData))
+    {
+        std::cout << "Wrong search of \"" << aNeedle << "\" in \"" << aData << "\" by " << aThreads
+                  << " threads, page " << PAGE_SIZE << std::endl;
+        throw std::runtime_error("Test failed");
+    }
+}
+
+// Needles planted across range borders, ranges shorter than the needle.
+template <size_t PAGE_SIZE, class SIZE_TYPE>
+void test()
+{
+    for (size_t sRound = 0; sRound < 32; sRound++)
+    {
+        std::string sNeedle;
+        for (size_t i = 1 + rand() % (3 * PAGE_SIZE); i > 0; i--)
+            sNeedle += 'a' + rand() % 3;
+        std::string sData;
+        for (size_t i = rand() % (64 * PAGE_SIZE); i > 0; i--)
+            sData += 'a' + rand() % 4;
+        for (size_t i = rand() % 16; i > 0 && !sData.empty(); i--)
+            sData.insert(rand() % sData.size(), sNeedle);
+        writeFile(sData);
+        for (size_t sThreads = 1; sThreads <= 9; sThreads += 2)
+            compare<PAGE_SIZE, SIZE_TYPE>(sNeedle, sData, sThreads);
+    }
+
+    writeFile("");
+    compare<PAGE_SIZE, SIZE_TYPE>("a", "", 4);
+    writeFile("aaaa");
+    compare<PAGE_SIZE, SIZE_TYPE>("aa", "aaaa", 8);
+    compare<PAGE_SIZE, SIZE_TYPE>("aaaaa", "aaaa", 8);
+}
+
+int main()
+{
+    int rc = EXIT_SUCCESS;
+    FileRemover sRemover;
+
+    try
+    {
+        test<8, uint8_t>();
+        test<64, uint16_t>();
+        test<4096, size_t>();
+
+        bool sThrown = false;
+        try
+        {
+            ParallelFinder<64>("a").find("./no_such.dat", 2);
+        }
+        catch (const std::exception&)
+        {
+            sThrown = true;
+        }
+        CHECK(sThrown);
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << e.what() << std::endl;
+        rc = EXIT_FAILURE;
+    }
+    if (rc == EXIT_SUCCESS)
+        std::cout << "Well done" << std::endl;
+    return rc;
+}
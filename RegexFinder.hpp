@@ -0,0 +1,448 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bitset>
+#include <climits>
+#include <cstdint>
+#include <limits>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// Searches a stream of bytes for a regular expression: feed() returns true
+// if a match ends at the fed byte. Supported syntax:
+//   concatenation, alternation a|b, grouping (...), repetition * + ?,
+//   . (any byte but a line feed), classes [a-z_] and [^...], escapes
+//   \d \w \s \D \W \S and \x for a literal x, line anchors ^ and $.
+// create() throws for an expression that matches the empty string (e.g. a*,
+// x? or ^), as it would match at every byte. A match that ends with $ is
+// reported by feed() of the line feed after it, one byte after the match
+// ends; a last line without a line feed never ends such a match.
+// The expression is compiled to an NFA, DFA states are materialized on
+// demand into a cache of rows laid out as in StringFinder. The cache holds
+// up to aCacheStates states and is flushed when full.
+template <class SIZE_TYPE = size_t>
+class RegexFinder
+{
+public:
+    static constexpr size_t DEFAULT_CACHE_STATES = 1024;
+
+    RegexFinder() {}
+    RegexFinder(std::string_view aRegex, size_t aCacheStates = DEFAULT_CACHE_STATES) { create(aRegex, aCacheStates); }
+    void create(std::string_view aRegex, size_t aCacheStates = DEFAULT_CACHE_STATES);
+    bool feed(char c);
+    // Back to the beginning of a stream, that is of a line.
+    void restart() { m_CurPos = m_StartPos; }
+    // Size of the materialized transition table in bytes.
+    size_t memory() const { return m_Index.size() * sizeof(arr_t); }
+
+    struct Stats
+    {
+        size_t m_States = 0; // Materialized since the last flush.
+        size_t m_Built = 0; // Transitions computed from the NFA.
+        size_t m_Flushes = 0;
+    };
+    const Stats& getStats() const { return m_Stats; }
+
+private:
+    using arr_t = std::array<SIZE_TYPE, 1ull << CHAR_BIT>;
+    using set_t = std::bitset<1ull << CHAR_BIT>;
+    static constexpr SIZE_TYPE UNKNOWN = std::numeric_limits<SIZE_TYPE>::max();
+    static constexpr uint32_t NONE = UINT32_MAX;
+
+    struct Node
+    {
+        enum Type { SET, SPLIT, EMPTY, BOL, EOL, MATCH } m_Type;
+        uint32_t m_Out = NONE;
+        uint32_t m_Out2 = NONE; // SPLIT only.
+        set_t m_Set; // SET only.
+    };
+
+    // Part of the NFA being built: the entry and the exits to patch.
+    struct Fragment
+    {
+        uint32_t m_Start;
+        std::vector<std::pair<uint32_t, bool>> m_Outs; // Node, m_Out2 or m_Out.
+    };
+
+    // A DFA state: waiting NFA nodes (SET and EOL) and whether a match has
+    // ended at the byte that led here.
+    using key_t = std::pair<std::vector<uint32_t>, bool>;
+
+    static size_t cast(char c) { return static_cast<size_t>(static_cast<unsigned char>(c)); }
+
+    // Parser, recursive descent over m_Regex from m_Parsed.
+    Fragment parseAlternation();
+    Fragment parseConcatenation();
+    Fragment parseRepetition();
+    Fragment parseAtom();
+    set_t parseClass();
+    set_t parseEscape();
+    [[noreturn]] void error(const char* aWhat) const;
+    bool more() const { return m_Parsed < m_Regex.size(); }
+    char peek() const { return m_Regex[m_Parsed]; }
+
+    uint32_t addNode(typename Node::Type aType, uint32_t aOut = NONE, uint32_t aOut2 = NONE);
+    Fragment single(typename Node::Type aType, const set_t& aSet = set_t());
+    void patch(const Fragment& aFragment, uint32_t aTarget);
+
+    void closure(std::vector<uint32_t>& aStack, bool aLineStart, std::vector<uint32_t>& aNodes, bool& aMatched);
+    SIZE_TYPE addState(key_t&& aKey);
+    SIZE_TYPE build(SIZE_TYPE aState, unsigned char c);
+    void flush();
+
+    std::string m_Regex;
+    size_t m_Parsed = 0;
+    std::vector<Node> m_Nodes;
+    uint32_t m_Start = NONE;
+    std::vector<uint32_t> m_Seen; // closure() marks, by generation.
+    uint32_t m_Generation = 0;
+
+    std::vector<arr_t> m_Index;
+    std::vector<uint8_t> m_Final;
+    std::vector<key_t> m_Keys;
+    std::map<key_t, SIZE_TYPE> m_States;
+    size_t m_CacheStates = DEFAULT_CACHE_STATES;
+    SIZE_TYPE m_StartPos = 0;
+    SIZE_TYPE m_CurPos = 0;
+    Stats m_Stats;
+};
+
+template <class SIZE_TYPE>
+inline void RegexFinder<SIZE_TYPE>::create(std::string_view aRegex, size_t aCacheStates)
+{
+    // Room for the start state, the one being left and the one entered.
+    if (aCacheStates < 3 || aCacheStates >= static_cast<size_t>(UNKNOWN))
+        throw std::runtime_error("Bad cache size");
+    m_Regex = aRegex;
+    m_Parsed = 0;
+    m_Nodes.clear();
+    Fragment sFragment = parseAlternation();
+    if (more())
+        error("unbalanced )");
+    uint32_t sMatch = addNode(Node::MATCH);
+    patch(sFragment, sMatch);
+    m_Start = sFragment.m_Start;
+    m_Seen.assign(m_Nodes.size(), 0);
+    m_Generation = 0;
+
+    std::vector<uint32_t> sStack{m_Start};
+    std::vector<uint32_t> sNodes;
+    bool sMatched = false;
+    closure(sStack, true, sNodes, sMatched);
+    if (sMatched)
+        throw std::runtime_error("Regular expression matches an empty string");
+
+    m_CacheStates = aCacheStates;
+    m_Stats = Stats();
+    flush();
+    m_Stats.m_Flushes = 0;
+}
+
+template <class SIZE_TYPE>
+inline bool RegexFinder<SIZE_TYPE>::feed(char c)
+{
+    SIZE_TYPE sNext = m_Index[m_CurPos][cast(c)];
+    if (sNext == UNKNOWN)
+        sNext = build(m_CurPos, cast(c));
+    m_CurPos = sNext;
+    return m_Final[sNext];
+}
+
+template <class SIZE_TYPE>
+inline void RegexFinder<SIZE_TYPE>::error(const char* aWhat) const
+{
+    throw std::runtime_error("Bad regular expression at " + std::to_string(m_Parsed) + ": " + aWhat);
+}
+
+template <class SIZE_TYPE>
+inline typename RegexFinder<SIZE_TYPE>::Fragment RegexFinder<SIZE_TYPE>::parseAlternation()
+{
+    Fragment sLeft = parseConcatenation();
+    while (more() && peek() == '|')
+    {
+        ++m_Parsed;
+        Fragment sRight = parseConcatenation();
+        uint32_t sSplit = addNode(Node::SPLIT, sLeft.m_Start, sRight.m_Start);
+        sLeft.m_Start = sSplit;
+        sLeft.m_Outs.insert(sLeft.m_Outs.end(), sRight.m_Outs.begin(), sRight.m_Outs.end());
+    }
+    return sLeft;
+}
+
+template <class SIZE_TYPE>
+inline typename RegexFinder<SIZE_TYPE>::Fragment RegexFinder<SIZE_TYPE>::parseConcatenation()
+{
+    if (!more() || peek() == '|' || peek() == ')')
+        return single(Node::EMPTY);
+    Fragment sResult = parseRepetition();
+    while (more() && peek() != '|' && peek() != ')')
+    {
+        Fragment sNext = parseRepetition();
+        patch(sResult, sNext.m_Start);
+        sResult.m_Outs = std::move(sNext.m_Outs);
+    }
+    return sResult;
+}
+
+template <class SIZE_TYPE>
+inline typename RegexFinder<SIZE_TYPE>::Fragment RegexFinder<SIZE_TYPE>::parseRepetition()
+{
+    Fragment sAtom = parseAtom();
+    while (more() && (peek() == '*' || peek() == '+' || peek() == '?'))
+    {
+        char sOp = m_Regex[m_Parsed++];
+        uint32_t sSplit = addNode(Node::SPLIT, sAtom.m_Start);
+        if (sOp == '?')
+        {
+            sAtom.m_Start = sSplit;
+            sAtom.m_Outs.emplace_back(sSplit, true);
+            continue;
+        }
+        patch(sAtom, sSplit);
+        if (sOp == '*')
+            sAtom.m_Start = sSplit;
+        sAtom.m_Outs.assign(1, {sSplit, true});
+    }
+    return sAtom;
+}
+
+template <class SIZE_TYPE>
+inline typename RegexFinder<SIZE_TYPE>::Fragment RegexFinder<SIZE_TYPE>::parseAtom()
+{
+    char c = m_Regex[m_Parsed++];
+    switch (c)
+    {
+        case '(':
+        {
+            Fragment sInner = parseAlternation();
+            if (!more() || peek() != ')')
+                error("missing )");
+            ++m_Parsed;
+            return sInner;
+        }
+        case '[':
+            return single(Node::SET, parseClass());
+        case '.':
+            return single(Node::SET, set_t().set().reset('\n'));
+        case '^':
+            return single(Node::BOL);
+        case '$':
+            return single(Node::EOL);
+        case '\\':
+            return single(Node::SET, parseEscape());
+        case '*':
+        case '+':
+        case '?':
+            error("nothing to repeat");
+        default:
+            return single(Node::SET, set_t().set(cast(c)));
+    }
+}
+
+template <class SIZE_TYPE>
+inline typename RegexFinder<SIZE_TYPE>::set_t RegexFinder<SIZE_TYPE>::parseClass()
+{
+    set_t sSet;
+    bool sNegate = more() && peek() == '^';
+    if (sNegate)
+        ++m_Parsed;
+    for (bool sFirst = true; ; sFirst = false)
+    {
+        if (!more())
+            error("missing ]");
+        char c = m_Regex[m_Parsed++];
+        if (c == ']' && !sFirst)
+            break;
+        if (c == '\\')
+        {
+            sSet |= parseEscape();
+            continue;
+        }
+        size_t sFrom = cast(c);
+        size_t sTo = sFrom;
+        if (m_Parsed + 1 < m_Regex.size() && peek() == '-' && m_Regex[m_Parsed + 1] != ']')
+        {
+            sTo = cast(m_Regex[m_Parsed + 1]);
+            m_Parsed += 2;
+            if (sTo < sFrom)
+                error("bad range");
+        }
+        for (size_t u = sFrom; u <= sTo; u++)
+            sSet.set(u);
+    }
+    return sNegate ? ~sSet : sSet;
+}
+
+template <class SIZE_TYPE>
+inline typename RegexFinder<SIZE_TYPE>::set_t RegexFinder<SIZE_TYPE>::parseEscape()
+{
+    if (!more())
+        error("trailing \\");
+    char c = m_Regex[m_Parsed++];
+    set_t sSet;
+    auto sRange = [&sSet](char aFrom, char aTo) { for (size_t u = cast(aFrom); u <= cast(aTo); u++) sSet.set(u); };
+    switch (c)
+    {
+        case 'd': case 'D':
+            sRange('0', '9');
+            break;
+        case 'w': case 'W':
+            sRange('0', '9');
+            sRange('a', 'z');
+            sRange('A', 'Z');
+            sSet.set('_');
+            break;
+        case 's': case 'S':
+            for (char sSpace : std::string_view(" \t\n\r\f\v"))
+                sSet.set(cast(sSpace));
+            break;
+        case 'n':
+            return sSet.set('\n');
+        case 't':
+            return sSet.set('\t');
+        default:
+            return sSet.set(cast(c));
+    }
+    return c >= 'A' && c <= 'Z' ? ~sSet : sSet;
+}
+
+template <class SIZE_TYPE>
+inline uint32_t RegexFinder<SIZE_TYPE>::addNode(typename Node::Type aType, uint32_t aOut, uint32_t aOut2)
+{
+    m_Nodes.emplace_back();
+    m_Nodes.back().m_Type = aType;
+    m_Nodes.back().m_Out = aOut;
+    m_Nodes.back().m_Out2 = aOut2;
+    return m_Nodes.size() - 1;
+}
+
+template <class SIZE_TYPE>
+inline typename RegexFinder<SIZE_TYPE>::Fragment RegexFinder<SIZE_TYPE>::single(typename Node::Type aType, const set_t& aSet)
+{
+    uint32_t sNode = addNode(aType);
+    m_Nodes[sNode].m_Set = aSet;
+    return Fragment{sNode, {{sNode, false}}};
+}
+
+template <class SIZE_TYPE>
+inline void RegexFinder<SIZE_TYPE>::patch(const Fragment& aFragment, uint32_t aTarget)
+{
+    for (const std::pair<uint32_t, bool>& sOut : aFragment.m_Outs)
+        (sOut.second ? m_Nodes[sOut.first].m_Out2 : m_Nodes[sOut.first].m_Out) = aTarget;
+}
+
+// Follows empty moves from aStack. Nodes that wait for a byte or for a line
+// end are added to aNodes, reaching MATCH sets aMatched.
+template <class SIZE_TYPE>
+inline void RegexFinder<SIZE_TYPE>::closure(std::vector<uint32_t>& aStack, bool aLineStart, std::vector<uint32_t>& aNodes, bool& aMatched)
+{
+    if (++m_Generation == 0)
+    {
+        std::fill(m_Seen.begin(), m_Seen.end(), 0);
+        m_Generation = 1;
+    }
+    while (!aStack.empty())
+    {
+        uint32_t sNode = aStack.back();
+        aStack.pop_back();
+        if (m_Seen[sNode] == m_Generation)
+            continue;
+        m_Seen[sNode] = m_Generation;
+        const Node& sRef = m_Nodes[sNode];
+        switch (sRef.m_Type)
+        {
+            case Node::SET:
+            case Node::EOL:
+                aNodes.push_back(sNode);
+                break;
+            case Node::MATCH:
+                aMatched = true;
+                break;
+            case Node::SPLIT:
+                aStack.push_back(sRef.m_Out2);
+                aStack.push_back(sRef.m_Out);
+                break;
+            case Node::BOL:
+                if (aLineStart)
+                    aStack.push_back(sRef.m_Out);
+                break;
+            case Node::EMPTY:
+                aStack.push_back(sRef.m_Out);
+                break;
+        }
+    }
+}
+
+template <class SIZE_TYPE>
+inline SIZE_TYPE RegexFinder<SIZE_TYPE>::addState(key_t&& aKey)
+{
+    std::sort(aKey.first.begin(), aKey.first.end());
+    auto sFound = m_States.find(aKey);
+    if (sFound != m_States.end())
+        return sFound->second;
+    SIZE_TYPE sState = m_Index.size();
+    m_Index.emplace_back();
+    m_Index.back().fill(UNKNOWN);
+    m_Final.push_back(aKey.second);
+    m_Keys.push_back(aKey);
+    m_States.emplace(std::move(aKey), sState);
+    ++m_Stats.m_States;
+    return sState;
+}
+
+// On a line feed the nodes waiting for a line end go on first, a match
+// they reach ends before it. Then the byte is consumed and, the search
+// being unanchored, a new match may start after it.
+template <class SIZE_TYPE>
+inline SIZE_TYPE RegexFinder<SIZE_TYPE>::build(SIZE_TYPE aState, unsigned char c)
+{
+    if (m_Index.size() >= m_CacheStates)
+    {
+        key_t sKey = m_Keys[aState];
+        flush();
+        aState = addState(std::move(sKey));
+    }
+    ++m_Stats.m_Built;
+
+    std::vector<uint32_t> sWaiting = m_Keys[aState].first;
+    bool sMatched = false;
+    if (c == '\n')
+    {
+        std::vector<uint32_t> sStack;
+        for (uint32_t sNode : m_Keys[aState].first)
+            if (m_Nodes[sNode].m_Type == Node::EOL)
+                sStack.push_back(m_Nodes[sNode].m_Out);
+        closure(sStack, false, sWaiting, sMatched);
+    }
+    std::vector<uint32_t> sStack{m_Start};
+    for (uint32_t sNode : sWaiting)
+        if (m_Nodes[sNode].m_Type == Node::SET && m_Nodes[sNode].m_Set.test(c))
+            sStack.push_back(m_Nodes[sNode].m_Out);
+    key_t sKey;
+    sKey.second = sMatched;
+    closure(sStack, c == '\n', sKey.first, sKey.second);
+    SIZE_TYPE sNext = addState(std::move(sKey));
+    m_Index[aState][c] = sNext;
+    return sNext;
+}
+
+template <class SIZE_TYPE>
+inline void RegexFinder<SIZE_TYPE>::flush()
+{
+    m_Index.clear();
+    m_Final.clear();
+    m_Keys.clear();
+    m_States.clear();
+    m_Stats.m_States = 0;
+    ++m_Stats.m_Flushes;
+
+    std::vector<uint32_t> sStack{m_Start};
+    key_t sKey;
+    closure(sStack, true, sKey.first, sKey.second);
+    m_StartPos = m_CurPos = addState(std::move(sKey));
+}
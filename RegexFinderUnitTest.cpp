@@ -0,0 +1,173 @@
+#include <RegexFinder.hpp>
+
+#include <cstdlib>
+#include <iostream>
+#include <regex>
+#include <stdexcept>
+
+void check(bool aExpession, const char* aMessage)
+{
+    if (!aExpession)
+    {
+        //assert(false);
+        throw std::runtime_error(aMessage);
+    }
+}
+
+#define CHECK(expr) check(expr, #expr);
+
+int rc = EXIT_SUCCESS;
+
+// Positions after the bytes at which feed() reported a match.
+template <class SIZE_TYPE>
+std::vector<size_t> calc(RegexFinder<SIZE_TYPE>& aFinder, std::string_view aHayStack)
+{
+    std::vector<size_t> sResult;
+    aFinder.restart();
+    for (size_t i = 0; i < aHayStack.size(); i++)
+        if (aFinder.feed(aHayStack[i]))
+            sResult.push_back(i + 1);
+    return sResult;
+}
+
+// The same by std::regex: some substring of a line ends at the position.
+std::vector<size_t> reference(const std::regex& aRegex, std::string_view aHayStack)
+{
+    std::vector<size_t> sResult;
+    for (size_t sEnd = 1; sEnd <= aHayStack.size(); sEnd++)
+    {
+        for (size_t sBegin = 0; sBegin < sEnd; sBegin++)
+        {
+            if (std::regex_match(aHayStack.begin() + sBegin, aHayStack.begin() + sEnd, aRegex))
+            {
+                sResult.push_back(sEnd);
+                break;
+            }
+        }
+    }
+    return sResult;
+}
+
+template <class SIZE_TYPE>
+void compare(std::string_view aRegex, std::string_view aHayStack, const std::vector<size_t>& aExpected, size_t aCacheStates)
+{
+    RegexFinder<SIZE_TYPE> sFinder(aRegex, aCacheStates);
+    std::vector<size_t> sFound = calc(sFinder, aHayStack);
+    // Twice: the second pass runs on the cached states.
+    if (sFound != aExpected || calc(sFinder, aHayStack) != aExpected)
+    {
+        std::cout << "Wrong search of /" << aRegex << "/ in \"" << aHayStack << "\", cache " << aCacheStates << "\n";
+        std::cout << "Found:    ";
+        for (size_t i = 0; i < sFound.size(); i++)
+            std::cout << (i ? ", " : "") << sFound[i];
+        std::cout << "\nExpected: ";
+        for (size_t i = 0; i < aExpected.size(); i++)
+            std::cout << (i ? ", " : "") << aExpected[i];
+        std::cout << "\n";
+        rc = EXIT_FAILURE;
+    }
+}
+
+void simple_test()
+{
+    compare<size_t>("abc", "abcabc", {3, 6}, 1024);
+    compare<size_t>("a|bc", "abcbc", {1, 3, 5}, 1024);
+    compare<size_t>("ab*c", "acabbbcabd", {2, 7}, 1024);
+    compare<size_t>("ab+c", "acabbbcabd", {7}, 1024);
+    compare<size_t>("ab?c", "acabcabbc", {2, 5}, 1024);
+    compare<size_t>("(ab)+", "ababxab", {2, 4, 7}, 1024);
+    compare<size_t>("[0-9a-f]x", "1x gx fx", {2, 8}, 1024);
+    compare<size_t>("[^a-z]x", "1x gx Fx", {2, 8}, 1024);
+    compare<size_t>("\\d\\d", "1a23", {4}, 1024);
+    compare<size_t>("\\w\\s\\W", "a -", {3}, 1024);
+    compare<size_t>("a.c", "abca\nc", {3}, 1024);
+    compare<size_t>("\\.\\*", "a.*", {3}, 1024);
+    compare<size_t>("[]x]", "a]x", {2, 3}, 1024);
+    compare<size_t>("^ab", "abab\nab", {2, 7}, 1024);
+    compare<size_t>("ab$", "abab\nab\n", {5, 8}, 1024);
+    compare<size_t>("^ab$", "ab\nxab\nab\n", {3, 10}, 1024);
+    compare<size_t>("^$", "a\n\n\nb", {3, 4}, 1024);
+    compare<size_t>("error|warn(ing)?", "error warning warn", {5, 10, 13, 18}, 1024);
+    compare<uint8_t>("(a|b)*c", "abacbbc", {4, 7}, 3);
+
+    for (std::string_view sBad : {"(a", "a)", "*a", "a|*", "[a", "[b-a]", "a\\", "", "a*", "^", "(|a)"})
+    {
+        bool sThrown = false;
+        try
+        {
+            RegexFinder<> sFinder(sBad);
+        }
+        catch (const std::runtime_error&)
+        {
+            sThrown = true;
+        }
+        if (!sThrown)
+        {
+            std::cout << "Bad regular expression accepted: /" << sBad << "/\n";
+            rc = EXIT_FAILURE;
+        }
+    }
+}
+
+// Random expressions vs std::regex, also with a cache that keeps flushing.
+void massive_test()
+{
+    const size_t ROUNDS = 512;
+    const char* sAtoms[] = {"a", "b", "c", ".", "[ab]", "[^a]", "(a|bc)", "(ab)"};
+    const char* sOps[] = {"", "", "", "*", "+", "?"};
+    for (size_t i = 0; i < ROUNDS; i++)
+    {
+        std::string sRegex;
+        for (size_t j = 1 + rand() % 4; j > 0; j--)
+        {
+            sRegex += sAtoms[rand() % 8];
+            sRegex += sOps[rand() % 6];
+            if (rand() % 8 == 0)
+                sRegex += '|';
+        }
+        if (sRegex.back() == '|')
+            sRegex.pop_back();
+        std::string sHayStack;
+        for (size_t j = rand() % 32; j > 0; j--)
+            sHayStack += static_cast<char>('a' + rand() % 3);
+
+        std::regex sStd(sRegex);
+        if (std::regex_match("", sStd))
+            continue;
+        std::vector<size_t> sExpected = reference(sStd, sHayStack);
+        compare<size_t>(sRegex, sHayStack, sExpected, 1024);
+        compare<uint16_t>(sRegex, sHayStack, sExpected, 3);
+    }
+}
+
+void cache_test()
+{
+    // Every distinct window of 8 bytes is a state of (a|b)*a.......
+    RegexFinder<uint16_t> sFinder("a[ab][ab][ab][ab][ab][ab][ab]x", 16);
+    std::string sHayStack;
+    for (size_t i = 0; i < 4096; i++)
+        sHayStack += 'a' + rand() % 2;
+    sHayStack += "x";
+    std::vector<size_t> sFound = calc(sFinder, sHayStack);
+    CHECK(sFinder.getStats().m_Flushes > 0);
+    CHECK(sFinder.memory() <= 16 * 256 * sizeof(uint16_t));
+    CHECK(sFound == (sHayStack[sHayStack.size() - 9] == 'a' ? std::vector<size_t>{sHayStack.size()} : std::vector<size_t>{}));
+}
+
+int main()
+{
+    try
+    {
+        simple_test();
+        massive_test();
+        cache_test();
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << e.what() << std::endl;
+        rc = EXIT_FAILURE;
+    }
+    if (rc == EXIT_SUCCESS)
+        std::cout << "Well done" << std::endl;
+    return rc;
+}
@@ -1,65 +1,750 @@
 #pragma once
 
+#include <algorithm>
 #include <array>
+#include <bitset>
 #include <climits>
+#include <cstdint>
+#include <cstring>
 #include <limits>
+#include <map>
 #include <stdexcept>
 #include <string_view>
 #include <type_traits>
 #include <vector>
 
-// std::numeric_limits<SIZE_TYPE>::max() limits search string length.
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define BANLOG_X86_SIMD
+#include <immintrin.h>
+#endif
+
+// Looks for the first p in [aBegin, aEnd) with (p[0] | m_FirstMask) ==
+// m_First and (p[m_Offset] | m_SecondMask) == m_Second; p[m_Offset] must
+// be readable for every such p. A mask of 0x20 makes an ASCII letter case
+// insensitive. Returns aEnd if there is none. SSE2 or AVX2 is chosen at run
+// time.
+class BytePairSearch
+{
+public:
+    BytePairSearch() {}
+    BytePairSearch(unsigned char aFirst, unsigned char aFirstMask, unsigned char aSecond, unsigned char aSecondMask, size_t aOffset)
+        : m_First(aFirst), m_FirstMask(aFirstMask), m_Second(aSecond), m_SecondMask(aSecondMask), m_Offset(aOffset) {}
+    const unsigned char* find(const unsigned char* aBegin, const unsigned char* aEnd) const;
+
+private:
+    const unsigned char* findScalar(const unsigned char* aBegin, const unsigned char* aEnd) const;
+#ifdef BANLOG_X86_SIMD
+    static bool hasAvx2();
+    const unsigned char* findSse2(const unsigned char* aBegin, const unsigned char* aEnd) const;
+    __attribute__((target("avx2")))
+    const unsigned char* findAvx2(const unsigned char* aBegin, const unsigned char* aEnd) const;
+#endif
+
+    unsigned char m_First = 0;
+    unsigned char m_FirstMask = 0;
+    unsigned char m_Second = 0;
+    unsigned char m_SecondMask = 0;
+    size_t m_Offset = 0;
+};
+
+inline const unsigned char* BytePairSearch::find(const unsigned char* aBegin, const unsigned char* aEnd) const
+{
+#ifdef BANLOG_X86_SIMD
+    if (hasAvx2())
+        return findAvx2(aBegin, aEnd);
+    return findSse2(aBegin, aEnd);
+#else
+    return findScalar(aBegin, aEnd);
+#endif
+}
+
+inline const unsigned char* BytePairSearch::findScalar(const unsigned char* aBegin, const unsigned char* aEnd) const
+{
+    const unsigned char* p = aBegin;
+    while (p != aEnd)
+    {
+        if (m_FirstMask == 0)
+        {
+            p = static_cast<const unsigned char*>(memchr(p, m_First, aEnd - p));
+            if (p == nullptr)
+                return aEnd;
+        }
+        else if ((*p | m_FirstMask) != m_First)
+        {
+            ++p;
+            continue;
+        }
+        if ((p[m_Offset] | m_SecondMask) == m_Second)
+            return p;
+        ++p;
+    }
+    return aEnd;
+}
+
+#ifdef BANLOG_X86_SIMD
+inline bool BytePairSearch::hasAvx2()
+{
+    static const bool sHas = __builtin_cpu_supports("avx2");
+    return sHas;
+}
+
+inline const unsigned char* BytePairSearch::findSse2(const unsigned char* aBegin, const unsigned char* aEnd) const
+{
+    const __m128i sFirst = _mm_set1_epi8(static_cast<char>(m_First));
+    const __m128i sFirstMask = _mm_set1_epi8(static_cast<char>(m_FirstMask));
+    const __m128i sSecond = _mm_set1_epi8(static_cast<char>(m_Second));
+    const __m128i sSecondMask = _mm_set1_epi8(static_cast<char>(m_SecondMask));
+    const unsigned char* p = aBegin;
+    for (; aEnd - p >= 16; p += 16)
+    {
+        __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + m_Offset));
+        a = _mm_cmpeq_epi8(sFirst, _mm_or_si128(a, sFirstMask));
+        b = _mm_cmpeq_epi8(sSecond, _mm_or_si128(b, sSecondMask));
+        unsigned sMask = _mm_movemask_epi8(_mm_and_si128(a, b));
+        if (sMask != 0)
+            return p + __builtin_ctz(sMask);
+    }
+    return findScalar(p, aEnd);
+}
+
+__attribute__((target("avx2")))
+inline const unsigned char* BytePairSearch::findAvx2(const unsigned char* aBegin, const unsigned char* aEnd) const
+{
+    const __m256i sFirst = _mm256_set1_epi8(static_cast<char>(m_First));
+    const __m256i sFirstMask = _mm256_set1_epi8(static_cast<char>(m_FirstMask));
+    const __m256i sSecond = _mm256_set1_epi8(static_cast<char>(m_Second));
+    const __m256i sSecondMask = _mm256_set1_epi8(static_cast<char>(m_SecondMask));
+    const unsigned char* p = aBegin;
+    for (; aEnd - p >= 32; p += 32)
+    {
+        __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+        __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + m_Offset));
+        a = _mm256_cmpeq_epi8(sFirst, _mm256_or_si256(a, sFirstMask));
+        b = _mm256_cmpeq_epi8(sSecond, _mm256_or_si256(b, sSecondMask));
+        unsigned sMask = _mm256_movemask_epi8(_mm256_and_si256(a, b));
+        if (sMask != 0)
+            return p + __builtin_ctz(sMask);
+    }
+    return findSse2(p, aEnd);
+}
+#endif
+
+// A search string with a set of allowed characters at every position.
+template <class CHAR = char>
+class StringPattern
+{
+public:
+    static_assert(std::is_integral_v<CHAR>, "Type expected to be integral");
+    using set_t = std::bitset<1ull << (sizeof(CHAR) * CHAR_BIT)>;
+
+    StringPattern() {}
+    StringPattern(std::basic_string_view<CHAR> aText, bool aIgnoreCase = false) { literal(aText, aIgnoreCase); }
+
+    // Appends positions. With aIgnoreCase ASCII letters match in any case.
+    StringPattern& literal(std::basic_string_view<CHAR> aText, bool aIgnoreCase = false);
+    StringPattern& oneOf(std::basic_string_view<CHAR> aChars);
+    StringPattern& range(CHAR aFrom, CHAR aTo);
+    StringPattern& digit() { return range('0', '9'); }
+    StringPattern& hex();
+    StringPattern& any();
+    StringPattern& set(const set_t& aSet);
+
+    size_t size() const { return m_Sets.size(); }
+    const set_t& operator[](size_t aPos) const { return m_Sets[aPos]; }
+
+private:
+    static size_t cast(CHAR c) { return static_cast<size_t>(static_cast< std::make_unsigned_t<CHAR> >(c)); }
+
+    std::vector<set_t> m_Sets;
+};
+
+template <typename CHAR>
+inline StringPattern<CHAR>& StringPattern<CHAR>::literal(std::basic_string_view<CHAR> aText, bool aIgnoreCase)
+{
+    for (CHAR c : aText)
+    {
+        set_t sSet;
+        sSet.set(cast(c));
+        if (aIgnoreCase && ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z')))
+            sSet.set(cast(c) ^ 0x20);
+        m_Sets.push_back(sSet);
+    }
+    return *this;
+}
+
+template <typename CHAR>
+inline StringPattern<CHAR>& StringPattern<CHAR>::oneOf(std::basic_string_view<CHAR> aChars)
+{
+    set_t sSet;
+    for (CHAR c : aChars)
+        sSet.set(cast(c));
+    return set(sSet);
+}
+
+template <typename CHAR>
+inline StringPattern<CHAR>& StringPattern<CHAR>::range(CHAR aFrom, CHAR aTo)
+{
+    set_t sSet;
+    for (size_t u = cast(aFrom); u <= cast(aTo); u++)
+        sSet.set(u);
+    return set(sSet);
+}
+
+template <typename CHAR>
+inline StringPattern<CHAR>& StringPattern<CHAR>::hex()
+{
+    set_t sSet;
+    for (CHAR c : std::string_view("0123456789abcdefABCDEF"))
+        sSet.set(cast(c));
+    return set(sSet);
+}
+
+template <typename CHAR>
+inline StringPattern<CHAR>& StringPattern<CHAR>::any()
+{
+    return set(set_t().set());
+}
+
+template <typename CHAR>
+inline StringPattern<CHAR>& StringPattern<CHAR>::set(const set_t& aSet)
+{
+    if (aSet.none())
+        throw std::runtime_error("Empty character set");
+    m_Sets.push_back(aSet);
+    return *this;
+}
+
+// Finds a needle or a StringPattern in a stream of characters. The pattern
+// is compiled into a DFA with a row of the whole alphabet per state, so any
+// pattern costs one table lookup per character. Size of the table is
+// (needle size + 1) rows for a literal needle or for a pattern whose sets
+// do not partially overlap (e.g. case insensitive one); other patterns
+// need up to std::numeric_limits<SIZE_TYPE>::max() states, or
+// MAX_PATTERN_STATES if that is less.
 template <class SIZE_TYPE = size_t, class CHAR = char>
 class StringFinder
 {
 public:
     static_assert(std::is_integral_v<CHAR>, "Type expected to be integral");
+    static constexpr size_t MAX_PATTERN_STATES = 64 * 1024;
+
     StringFinder() {}
-    StringFinder(std::basic_string_view<CHAR> aNeedle) { create(aNeedle); }
-    void create(std::basic_string_view<CHAR> aNeedle);
+    StringFinder(std::basic_string_view<CHAR> aNeedle, bool aIgnoreCase = false) { create(aNeedle, aIgnoreCase); }
+    StringFinder(const StringPattern<CHAR>& aPattern) { create(aPattern); }
+    void create(std::basic_string_view<CHAR> aNeedle, bool aIgnoreCase = false);
+    void create(const StringPattern<CHAR>& aPattern);
     bool feed(CHAR c);
+    // The same as feeding aHayStack until feed() returns true. Returns the
+    // number of characters consumed, i.e. the match ends right before the
+    // returned offset, or npos if all of them were fed without a match.
+    // While nothing is matched, single byte characters are skipped with
+    // BytePairSearch for the first needle character paired with the rarest
+    // one, provided the first one is a character or a letter in any case.
+    size_t find(std::basic_string_view<CHAR> aHayStack);
+    // Feeds [aBegin, aEnd) and writes the offset past the end of every
+    // match, relative to aBegin, to aMatches. The state is kept, so a
+    // stream may be fed buffer by buffer; the caller adds buffer offsets.
+    template <class OutputIt>
+    OutputIt feed(const CHAR* aBegin, const CHAR* aEnd, OutputIt aMatches);
     void restart() { m_CurPos = 0; }
+    // Length of a match.
+    size_t size() const { return m_Size; }
+    // Size of the transition table in bytes.
+    size_t memory() const { return m_Index.size() * sizeof(arr_t); }
+
+    static constexpr size_t npos = std::basic_string_view<CHAR>::npos;
 
 private:
     using arr_t = std::array<SIZE_TYPE, 1ull << (sizeof(CHAR) * CHAR_BIT)>;
+    using set_t = typename StringPattern<CHAR>::set_t;
 
     static size_t cast(CHAR c) { return static_cast<size_t>(static_cast< std::make_unsigned_t<CHAR> >(c)); }
+    static size_t rarity(size_t u);
+    static bool byteFilter(const set_t& aSet, unsigned char& aValue, unsigned char& aMask);
+    void createLinear(const StringPattern<CHAR>& aPattern);
+    void createSubsets(const StringPattern<CHAR>& aPattern);
+    void createFilter(const StringPattern<CHAR>& aPattern);
+    const CHAR* skip(const CHAR* aBegin, const CHAR* aEnd) const;
 
+    // States that complete a match are numbered last, from m_FinPos on; they
+    // have own rows, so nothing is reset after a match.
     std::vector<arr_t> m_Index;
     SIZE_TYPE m_CurPos;
     SIZE_TYPE m_FinPos;
-    SIZE_TYPE m_RepPos;
+    size_t m_Size;
+    bool m_Skip;
+    BytePairSearch m_Prefilter;
 };
 
+// Knuth-Morris-Pratt: state i means i characters of the needle are
+// matched; a mismatch falls back along the longest proper border, which
+// m_Index[m_RepPos] already has the transitions of. The final state reads
+// on as the border does.
 template <typename SIZE_TYPE, typename CHAR>
-inline void StringFinder<SIZE_TYPE, CHAR>::create(std::basic_string_view<CHAR> aNeedle)
+inline void StringFinder<SIZE_TYPE, CHAR>::create(std::basic_string_view<CHAR> aNeedle, bool aIgnoreCase)
 {
+    if (aIgnoreCase)
+        return create(StringPattern<CHAR>(aNeedle, true));
     if (aNeedle.size() == 0)
         throw std::runtime_error("Cannot search an empty string");
     if (aNeedle.size() > static_cast<size_t>(std::numeric_limits<SIZE_TYPE>::max()))
         throw std::runtime_error("Search string is too big");
 
-    m_Index.resize(aNeedle.size());
+    m_Index.resize(aNeedle.size() + 1);
     m_Index[0] = {};
-    m_CurPos = m_FinPos = m_RepPos = 0;
+    size_t sRepPos = 0;
     for (size_t i = 0; i < aNeedle.size(); i++)
     {
         size_t u = cast(aNeedle[i]);
-        ++m_FinPos;
-        m_Index[i] = m_Index[m_RepPos];
-        m_RepPos = m_Index[i][u];
-        m_Index[i][u] = m_FinPos;
+        m_Index[i] = m_Index[sRepPos];
+        sRepPos = m_Index[i][u];
+        m_Index[i][u] = i + 1;
+    }
+    m_Index[aNeedle.size()] = m_Index[sRepPos];
+    m_CurPos = 0;
+    m_FinPos = aNeedle.size();
+    m_Size = aNeedle.size();
+
+    m_Skip = sizeof(CHAR) == 1;
+    if (m_Skip)
+    {
+        size_t sRare = 0;
+        for (size_t i = 1; i < aNeedle.size(); i++)
+            if (sRare == 0 || rarity(cast(aNeedle[i])) > rarity(cast(aNeedle[sRare])))
+                sRare = i;
+        m_Prefilter = BytePairSearch(cast(aNeedle[0]), 0, cast(aNeedle[sRare]), 0, sRare);
     }
 }
 
 template <typename SIZE_TYPE, typename CHAR>
-inline bool StringFinder<SIZE_TYPE, CHAR>::feed(CHAR c)
+inline void StringFinder<SIZE_TYPE, CHAR>::create(const StringPattern<CHAR>& aPattern)
 {
-    m_CurPos = m_Index[m_CurPos][cast(c)];
-    if (m_CurPos == m_FinPos)
+    if (aPattern.size() == 0)
+        throw std::runtime_error("Cannot search an empty string");
+    if (aPattern.size() > static_cast<size_t>(std::numeric_limits<SIZE_TYPE>::max()))
+        throw std::runtime_error("Search string is too big");
+
+    // Sets that are equal or disjoint behave as single characters of a
+    // smaller alphabet, the needle over it is searched with KMP.
+    std::vector<set_t> sDistinct;
+    bool sLinear = true;
+    for (size_t i = 0; i < aPattern.size() && sLinear; i++)
     {
-        m_CurPos = m_RepPos;
+        if (std::find(sDistinct.begin(), sDistinct.end(), aPattern[i]) != sDistinct.end())
+            continue;
+        for (const set_t& sSet : sDistinct)
+            sLinear = sLinear && (sSet & aPattern[i]).none();
+        sDistinct.push_back(aPattern[i]);
+    }
+    if (sLinear)
+        createLinear(aPattern);
+    else
+        createSubsets(aPattern);
+    m_CurPos = 0;
+    m_Size = aPattern.size();
+    createFilter(aPattern);
+}
+
+// The same as the literal create(): all characters of a set have equal
+// columns, so the first one stands for the set.
+template <typename SIZE_TYPE, typename CHAR>
+inline void StringFinder<SIZE_TYPE, CHAR>::createLinear(const StringPattern<CHAR>& aPattern)
+{
+    m_Index.resize(aPattern.size() + 1);
+    m_Index[0] = {};
+    size_t sRepPos = 0;
+    for (size_t i = 0; i < aPattern.size(); i++)
+    {
+        const set_t& sSet = aPattern[i];
+        m_Index[i] = m_Index[sRepPos];
+        sRepPos = npos;
+        for (size_t u = 0; u < sSet.size(); u++)
+        {
+            if (sSet.test(u))
+            {
+                if (sRepPos == npos)
+                    sRepPos = m_Index[i][u];
+                m_Index[i][u] = i + 1;
+            }
+        }
+    }
+    m_Index[aPattern.size()] = m_Index[sRepPos];
+    m_FinPos = aPattern.size();
+}
+
+// A state is the set of matched pattern prefixes, bit i for i characters.
+// Overlapping sets can keep prefixes alive that a single longest one does
+// not tell, so the DFA is built by subset construction from the states that
+// are reachable.
+template <typename SIZE_TYPE, typename CHAR>
+inline void StringFinder<SIZE_TYPE, CHAR>::createSubsets(const StringPattern<CHAR>& aPattern)
+{
+    using subset_t = std::vector<uint64_t>;
+    const size_t sSize = aPattern.size();
+    const size_t sWords = sSize / 64 + 1;
+    const size_t sLimit = std::min(MAX_PATTERN_STATES, static_cast<size_t>(std::numeric_limits<SIZE_TYPE>::max()));
+
+    // Prefixes a character extends.
+    std::vector<subset_t> sExtends(std::tuple_size_v<arr_t>, subset_t(sWords));
+    for (size_t i = 0; i < sSize; i++)
+        for (size_t u = 0; u < sExtends.size(); u++)
+            if (aPattern[i].test(u))
+                sExtends[u][i / 64] |= 1ull << (i % 64);
+
+    std::vector<subset_t> sStates(1, subset_t(sWords));
+    sStates[0][0] = 1;
+    std::map<subset_t, size_t> sIds{{sStates[0], 0}};
+    std::vector<arr_t> sIndex;
+    subset_t sNext(sWords);
+    for (size_t sState = 0; sState < sStates.size(); sState++)
+    {
+        sIndex.emplace_back();
+        for (size_t u = 0; u < sExtends.size(); u++)
+        {
+            uint64_t sCarry = 1;
+            for (size_t w = 0; w < sWords; w++)
+            {
+                uint64_t sBits = sStates[sState][w] & sExtends[u][w];
+                sNext[w] = (sBits << 1) | sCarry;
+                sCarry = sBits >> 63;
+            }
+            auto sFound = sIds.find(sNext);
+            if (sFound == sIds.end())
+            {
+                if (sStates.size() >= sLimit)
+                    throw std::runtime_error("Search pattern is too complex");
+                sFound = sIds.emplace(sNext, sStates.size()).first;
+                sStates.push_back(sNext);
+            }
+            sIndex[sState][u] = sFound->second;
+        }
+    }
+
+    // Renumber so that feed() tells a match by a single comparison.
+    auto sFinal = [&](size_t aState) { return (sStates[aState][sSize / 64] >> (sSize % 64)) & 1; };
+    std::vector<size_t> sNew(sStates.size());
+    size_t sNextId = 0;
+    for (size_t sState = 0; sState < sStates.size(); sState++)
+        if (!sFinal(sState))
+            sNew[sState] = sNextId++;
+    m_FinPos = sNextId;
+    for (size_t sState = 0; sState < sStates.size(); sState++)
+        if (sFinal(sState))
+            sNew[sState] = sNextId++;
+    m_Index.resize(sStates.size());
+    for (size_t sState = 0; sState < sStates.size(); sState++)
+        for (size_t u = 0; u < sExtends.size(); u++)
+            m_Index[sNew[sState]][u] = sNew[sIndex[sState][u]];
+}
+
+// The set as p | aMask == aValue: a single character, or an ASCII letter
+// in both cases.
+template <typename SIZE_TYPE, typename CHAR>
+inline bool StringFinder<SIZE_TYPE, CHAR>::byteFilter(const set_t& aSet, unsigned char& aValue, unsigned char& aMask)
+{
+    size_t sFirst = 0;
+    while (!aSet.test(sFirst))
+        ++sFirst;
+    if (aSet.count() == 1)
+    {
+        aValue = sFirst;
+        aMask = 0;
+        return true;
+    }
+    if (aSet.count() == 2 && aSet.test(sFirst | 0x20) && (sFirst | 0x20) != sFirst)
+    {
+        aValue = sFirst | 0x20;
+        aMask = 0x20;
         return true;
     }
     return false;
 }
+
+template <typename SIZE_TYPE, typename CHAR>
+inline void StringFinder<SIZE_TYPE, CHAR>::createFilter(const StringPattern<CHAR>& aPattern)
+{
+    unsigned char sFirst, sFirstMask, sRare, sRareMask;
+    m_Skip = sizeof(CHAR) == 1 && byteFilter(aPattern[0], sFirst, sFirstMask);
+    if (!m_Skip)
+        return;
+    sRare = sFirst;
+    sRareMask = sFirstMask;
+    size_t sRareOffset = 0;
+    for (size_t i = 1; i < aPattern.size(); i++)
+    {
+        unsigned char sValue, sMask;
+        if (byteFilter(aPattern[i], sValue, sMask) && (sRareOffset == 0 || rarity(sValue) > rarity(sRare)))
+        {
+            sRare = sValue;
+            sRareMask = sMask;
+            sRareOffset = i;
+        }
+    }
+    m_Prefilter = BytePairSearch(sFirst, sFirstMask, sRare, sRareMask, sRareOffset);
+}
+
+template <typename SIZE_TYPE, typename CHAR>
+inline bool StringFinder<SIZE_TYPE, CHAR>::feed(CHAR c)
+{
+    m_CurPos = m_Index[m_CurPos][cast(c)];
+    return m_CurPos >= m_FinPos;
+}
+
+template <typename SIZE_TYPE, typename CHAR>
+inline size_t StringFinder<SIZE_TYPE, CHAR>::find(std::basic_string_view<CHAR> aHayStack)
+{
+    const CHAR* sBegin = aHayStack.data();
+    const CHAR* sEnd = sBegin + aHayStack.size();
+    const CHAR* p = sBegin;
+    while (p != sEnd)
+    {
+        if (m_CurPos == 0)
+        {
+            p = skip(p, sEnd);
+            if (p == sEnd)
+                break;
+        }
+        if (feed(*p++))
+            return p - sBegin;
+    }
+    return npos;
+}
+
+// The state lives in a register, the initial state is left with the same
+// skip as find() when there is a prefilter, and match offsets are collected
+// in a local batch that is flushed to aMatches when full and at the end.
+template <typename SIZE_TYPE, typename CHAR>
+template <class OutputIt>
+inline OutputIt StringFinder<SIZE_TYPE, CHAR>::feed(const CHAR* aBegin, const CHAR* aEnd, OutputIt aMatches)
+{
+    constexpr size_t BATCH = 64;
+    size_t sBatch[BATCH];
+    size_t sCount = 0;
+    const arr_t* sIndex = m_Index.data();
+    const SIZE_TYPE sFinPos = m_FinPos;
+    SIZE_TYPE sCurPos = m_CurPos;
+    auto sEmit = [&](const CHAR* p)
+    {
+        sBatch[sCount++] = p - aBegin;
+        if (sCount == BATCH)
+        {
+            aMatches = std::copy(sBatch, sBatch + sCount, aMatches);
+            sCount = 0;
+        }
+    };
+    const CHAR* p = aBegin;
+    if (m_Skip)
+    {
+        while (p != aEnd)
+        {
+            if (sCurPos == 0)
+            {
+                p = skip(p, aEnd);
+                if (p == aEnd)
+                    break;
+            }
+            sCurPos = sIndex[sCurPos][cast(*p++)];
+            if (sCurPos >= sFinPos)
+                sEmit(p);
+        }
+    }
+    else
+    {
+        while (p != aEnd)
+        {
+            sCurPos = sIndex[sCurPos][cast(*p++)];
+            if (sCurPos >= sFinPos)
+                sEmit(p);
+        }
+    }
+    aMatches = std::copy(sBatch, sBatch + sCount, aMatches);
+    m_CurPos = sCurPos;
+    return aMatches;
+}
+
+// Rough frequency of a character in log text, higher is rarer.
+template <typename SIZE_TYPE, typename CHAR>
+inline size_t StringFinder<SIZE_TYPE, CHAR>::rarity(size_t u)
+{
+    static constexpr std::string_view sCommon = " 0123456789etaoinsrlcdumhpgbfywkvxzjq.:-=_/[]()ETAOINSRLCDUMHPGBFYWKVXZJQ";
+    size_t sPos = u < 128 ? sCommon.find(static_cast<char>(u)) : sCommon.npos;
+    return sPos == sCommon.npos ? sCommon.size() : sPos;
+}
+
+// In the initial state a match can only start at a candidate of the
+// prefilter, so everything before the first one is skipped. Without a
+// candidate only the last (needle size - 1) characters may begin a match
+// that ends in a later buffer; they are left to be fed.
+template <typename SIZE_TYPE, typename CHAR>
+inline const CHAR* StringFinder<SIZE_TYPE, CHAR>::skip(const CHAR* aBegin, const CHAR* aEnd) const
+{
+    if constexpr (sizeof(CHAR) != 1)
+    {
+        return aBegin;
+    }
+    else
+    {
+        size_t sTail = m_Size - 1;
+        if (!m_Skip || static_cast<size_t>(aEnd - aBegin) <= sTail)
+            return aBegin;
+        const unsigned char* sBegin = reinterpret_cast<const unsigned char*>(aBegin);
+        const unsigned char* p = m_Prefilter.find(sBegin, reinterpret_cast<const unsigned char*>(aEnd - sTail));
+        return aBegin + (p - sBegin);
+    }
+}
+
+// The same automaton with the alphabet compressed to the characters of the
+// needle plus one class for all the others: a state takes a row of
+// (distinct characters + 1) entries instead of the whole alphabet, at the
+// cost of one more (state independent) lookup per character.
+template <class SIZE_TYPE = size_t, class CHAR = char>
+class CompactStringFinder
+{
+public:
+    static_assert(std::is_integral_v<CHAR>, "Type expected to be integral");
+    CompactStringFinder() {}
+    CompactStringFinder(std::basic_string_view<CHAR> aNeedle) { create(aNeedle); }
+    void create(std::basic_string_view<CHAR> aNeedle);
+    bool feed(CHAR c);
+    void restart() { m_CurPos = 0; }
+    // Size of the class map and the transition table in bytes.
+    size_t memory() const { return sizeof(m_Classes) + m_Index.size() * sizeof(SIZE_TYPE); }
+
+private:
+    using class_t = std::make_unsigned_t<CHAR>;
+    static constexpr size_t ALPHABET = 1ull << (sizeof(CHAR) * CHAR_BIT);
+
+    static size_t cast(CHAR c) { return static_cast<size_t>(static_cast<class_t>(c)); }
+
+    std::array<class_t, ALPHABET> m_Classes;
+    size_t m_ClassCount;
+    // m_ClassCount entries per state. As in StringFinder the final state is
+    // numbered last and has an own row, so nothing is reset after a match.
+    std::vector<SIZE_TYPE> m_Index;
+    SIZE_TYPE m_CurPos;
+    SIZE_TYPE m_FinPos;
+};
+
+template <typename SIZE_TYPE, typename CHAR>
+inline void CompactStringFinder<SIZE_TYPE, CHAR>::create(std::basic_string_view<CHAR> aNeedle)
+{
+    if (aNeedle.size() == 0)
+        throw std::runtime_error("Cannot search an empty string");
+    if (aNeedle.size() > static_cast<size_t>(std::numeric_limits<SIZE_TYPE>::max()))
+        throw std::runtime_error("Search string is too big");
+
+    // Class 0 is for characters out of the needle, if there are any.
+    std::vector<bool> sSeen(ALPHABET);
+    size_t sDistinct = 0;
+    for (CHAR c : aNeedle)
+    {
+        if (!sSeen[cast(c)])
+        {
+            sSeen[cast(c)] = true;
+            ++sDistinct;
+        }
+    }
+    m_Classes.fill(0);
+    m_ClassCount = sDistinct < ALPHABET ? 1 : 0;
+    sSeen.assign(ALPHABET, false);
+    for (CHAR c : aNeedle)
+    {
+        if (!sSeen[cast(c)])
+        {
+            sSeen[cast(c)] = true;
+            m_Classes[cast(c)] = m_ClassCount++;
+        }
+    }
+
+    m_Index.assign((aNeedle.size() + 1) * m_ClassCount, 0);
+    size_t sRepPos = 0;
+    for (size_t i = 0; i < aNeedle.size(); i++)
+    {
+        size_t u = m_Classes[cast(aNeedle[i])];
+        if (i != 0)
+            std::copy_n(&m_Index[sRepPos * m_ClassCount], m_ClassCount, &m_Index[i * m_ClassCount]);
+        sRepPos = m_Index[i * m_ClassCount + u];
+        m_Index[i * m_ClassCount + u] = i + 1;
+    }
+    std::copy_n(&m_Index[sRepPos * m_ClassCount], m_ClassCount, &m_Index[aNeedle.size() * m_ClassCount]);
+    m_CurPos = 0;
+    m_FinPos = aNeedle.size();
+}
+
+template <typename SIZE_TYPE, typename CHAR>
+inline bool CompactStringFinder<SIZE_TYPE, CHAR>::feed(CHAR c)
+{
+    m_CurPos = m_Index[m_CurPos * m_ClassCount + m_Classes[cast(c)]];
+    return m_CurPos >= m_FinPos;
+}
+
+// Transition table of a needle known at compile time, see makeStringTable().
+// The table is sized exactly to the needle and its entries are the
+// smallest unsigned type that holds a state.
+template <size_t LENGTH, class CHAR = char>
+class StaticStringTable
+{
+public:
+    static_assert(std::is_integral_v<CHAR>, "Type expected to be integral");
+    static_assert(LENGTH != 0, "Cannot search an empty string");
+
+    using char_type = CHAR;
+    using size_type = std::conditional_t<LENGTH <= UINT8_MAX, uint8_t,
+                      std::conditional_t<LENGTH <= UINT16_MAX, uint16_t,
+                      std::conditional_t<LENGTH <= UINT32_MAX, uint32_t, size_t>>>;
+    static constexpr size_t ALPHABET = 1ull << (sizeof(CHAR) * CHAR_BIT);
+
+    // The same construction as StringFinder::create().
+    constexpr StaticStringTable(const CHAR (&aNeedle)[LENGTH + 1])
+    {
+        size_t sRepPos = 0;
+        for (size_t i = 0; i < LENGTH; i++)
+        {
+            size_t u = cast(aNeedle[i]);
+            m_Index[i] = m_Index[sRepPos];
+            sRepPos = m_Index[i][u];
+            m_Index[i][u] = i + 1;
+        }
+        m_Index[LENGTH] = m_Index[sRepPos];
+    }
+
+    constexpr size_type next(size_type aState, CHAR c) const { return m_Index[aState][cast(c)]; }
+    static constexpr size_t size() { return LENGTH; }
+    static constexpr size_t memory() { return sizeof(m_Index); }
+
+private:
+    static constexpr size_t cast(CHAR c) { return static_cast<size_t>(static_cast< std::make_unsigned_t<CHAR> >(c)); }
+
+    std::array<std::array<size_type, ALPHABET>, LENGTH + 1> m_Index{};
+};
+
+template <class CHAR, size_t SIZE>
+constexpr StaticStringTable<SIZE - 1, CHAR> makeStringTable(const CHAR (&aNeedle)[SIZE])
+{
+    return StaticStringTable<SIZE - 1, CHAR>(aNeedle);
+}
+
+// StringFinder over a table built at compile time: the table is addressed
+// directly, e.g.
+//   inline constexpr auto sBanned = makeStringTable("banned");
+//   StaticStringFinder<sBanned> sFinder;
+template <const auto& TABLE>
+class StaticStringFinder
+{
+public:
+    using table_t = std::remove_cv_t<std::remove_reference_t<decltype(TABLE)>>;
+    using char_type = typename table_t::char_type;
+    using size_type = typename table_t::size_type;
+
+    bool feed(char_type c)
+    {
+        m_CurPos = TABLE.next(m_CurPos, c);
+        return m_CurPos == table_t::size();
+    }
+    void restart() { m_CurPos = 0; }
+    static constexpr size_t size() { return table_t::size(); }
+
+private:
+    size_type m_CurPos = 0;
+};
@@ -0,0 +1,256 @@
+#include <FileReaderTestUtils.hpp>
+#include <MultiStringFinder.hpp>
+#include <RegexFinder.hpp>
+#include <StringFinder.hpp>
+
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <iterator>
+#include <regex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+static void checkpoint(const char* aText, size_t aBytes)
+{
+    using namespace std::chrono;
+    high_resolution_clock::time_point now = high_resolution_clock::now();
+    static high_resolution_clock::time_point was;
+    duration<double> time_span = duration_cast<duration<double>>(now - was);
+    if (0 != aBytes)
+    {
+        double MBps = aBytes / 1024. / 1024. / time_span.count();
+        if (MBps < 1024)
+            std::cout << aText << ":\t" << MBps << " MB/s" << std::endl;
+        else
+            std::cout << aText << ":\t" << MBps / 1024 << " GB/s" << std::endl;
+    }
+    was = now;
+}
+
+// "request request", "request accepted", ...: every one occurs in the log.
+std::vector<std::string> makeNeedles(size_t aCount)
+{
+    const std::vector<std::string>& sWords = logWords();
+    std::vector<std::string> sNeedles;
+    for (size_t i = 0; i < aCount; i++)
+        sNeedles.push_back(sWords[i / sWords.size() % sWords.size()] + " " + sWords[i % sWords.size()]);
+    return sNeedles;
+}
+
+// One pass over the log with N finders fed per byte vs one automaton.
+void runMulti(std::string_view aText, size_t aCount)
+{
+    std::vector<std::string> sNeedles = makeNeedles(aCount);
+    std::cout << "Needles: " << aCount << std::endl;
+
+    std::vector<StringFinder<uint16_t>> sFinders;
+    for (const std::string& sNeedle : sNeedles)
+        sFinders.emplace_back(sNeedle);
+    size_t sum = 0;
+    checkpoint("", 0);
+    for (char c : aText)
+        for (StringFinder<uint16_t>& sFinder : sFinders)
+            sum += sFinder.feed(c);
+    checkpoint("N x StringFinder", aText.size());
+    std::cout << "Check: " << sum << std::endl;
+
+    MultiStringFinder<uint16_t> sMulti(std::vector<std::string_view>(sNeedles.begin(), sNeedles.end()));
+    sum = 0;
+    checkpoint("", 0);
+    for (char c : aText)
+        if (sMulti.feed(c))
+            sum += sMulti.matches().size();
+    checkpoint("MultiStringFinder", aText.size());
+    std::cout << "Check: " << sum << std::endl;
+}
+
+template <class FINDER>
+void runFinder(const char* aName, std::string_view aText, std::string_view aNeedle)
+{
+    FINDER sFinder(aNeedle);
+    size_t sum = 0;
+    checkpoint("", 0);
+    for (char c : aText)
+        sum += sFinder.feed(c);
+    checkpoint(aName, aText.size());
+    std::cout << "Check: " << sum << ", table: " << sFinder.memory() << " bytes" << std::endl;
+}
+
+// Dense vs byte-class compressed tables; needles are taken from the text.
+void runLengths(std::string_view aText)
+{
+    for (size_t sLength : {4, 16, 64, 256, 1024, 4096})
+    {
+        std::string_view sNeedle = aText.substr(aText.size() / 2, sLength);
+        std::cout << "Needle length: " << sLength << std::endl;
+        runFinder<StringFinder<size_t>>("dense<size_t>", aText, sNeedle);
+        runFinder<CompactStringFinder<size_t>>("compact<size_t>", aText, sNeedle);
+        runFinder<StringFinder<uint16_t>>("dense<uint16_t>", aText, sNeedle);
+        runFinder<CompactStringFinder<uint16_t>>("compact<uint16_t>", aText, sNeedle);
+    }
+}
+
+// Per byte feed() vs find() with the vectorized skip over the same text.
+void runFind(std::string_view aText, std::string_view aNeedle)
+{
+    std::cout << "Needle: \"" << aNeedle << "\"" << std::endl;
+    StringFinder<uint16_t> sFinder(aNeedle);
+    size_t sum = 0;
+    checkpoint("", 0);
+    for (char c : aText)
+        sum += sFinder.feed(c);
+    checkpoint("feed", aText.size());
+    std::cout << "Check: " << sum << std::endl;
+
+    sFinder.restart();
+    sum = 0;
+    checkpoint("", 0);
+    for (std::string_view sRest = aText; ; ++sum)
+    {
+        size_t sPos = sFinder.find(sRest);
+        if (sPos == sFinder.npos)
+            break;
+        sRest.remove_prefix(sPos);
+    }
+    checkpoint("find", aText.size());
+    std::cout << "Check: " << sum << std::endl;
+}
+
+// Per byte feed() vs the bulk one, in 4K buffers as FileReader gives them.
+void runBulk(std::string_view aText, std::string_view aNeedle)
+{
+    const size_t BUFFER = 4096;
+    std::cout << "Needle: \"" << aNeedle << "\"" << std::endl;
+    StringFinder<uint16_t> sFinder(aNeedle);
+    size_t sum = 0;
+    checkpoint("", 0);
+    for (size_t i = 0; i < aText.size(); i++)
+        if (sFinder.feed(aText[i]))
+            sum += i + 1;
+    checkpoint("feed byte", aText.size());
+    std::cout << "Check: " << sum << std::endl;
+
+    sFinder.restart();
+    sum = 0;
+    std::vector<size_t> sEnds;
+    checkpoint("", 0);
+    for (size_t i = 0; i < aText.size(); i += BUFFER)
+    {
+        std::string_view sBuffer = aText.substr(i, BUFFER);
+        sEnds.clear();
+        sFinder.feed(sBuffer.data(), sBuffer.data() + sBuffer.size(), std::back_inserter(sEnds));
+        for (size_t sEnd : sEnds)
+            sum += i + sEnd;
+    }
+    checkpoint("feed bulk", aText.size());
+    std::cout << "Check: " << sum << std::endl;
+}
+
+// Patterns cost the same per byte as literals: one table lookup; the bulk
+// feed() skips only while the first position is a character or a letter.
+void runPattern(const char* aName, std::string_view aText, const StringPattern<char>& aPattern)
+{
+    StringFinder<uint16_t> sFinder(aPattern);
+    std::cout << "Pattern: " << aName << ", table: " << sFinder.memory() << " bytes" << std::endl;
+    size_t sum = 0;
+    checkpoint("", 0);
+    for (char c : aText)
+        sum += sFinder.feed(c);
+    checkpoint("feed byte", aText.size());
+    std::cout << "Check: " << sum << std::endl;
+
+    sFinder.restart();
+    std::vector<size_t> sEnds;
+    checkpoint("", 0);
+    sFinder.feed(aText.data(), aText.data() + aText.size(), std::back_inserter(sEnds));
+    checkpoint("feed bulk", aText.size());
+    std::cout << "Check: " << sEnds.size() << std::endl;
+}
+
+constexpr auto sTableBanned = makeStringTable("banned");
+constexpr auto sTableIp = makeStringTable("ip=127.0.0.1 ");
+
+// The same per byte loop over the heap table and over a compile-time one.
+template <const auto& TABLE>
+void runStatic(std::string_view aText, std::string_view aNeedle)
+{
+    std::cout << "Needle: \"" << aNeedle << "\"" << std::endl;
+    StringFinder<uint8_t> sFinder(aNeedle);
+    size_t sum = 0;
+    checkpoint("", 0);
+    for (char c : aText)
+        sum += sFinder.feed(c);
+    checkpoint("StringFinder", aText.size());
+    std::cout << "Check: " << sum << ", table: " << sFinder.memory() << " bytes" << std::endl;
+
+    StaticStringFinder<TABLE> sStatic;
+    sum = 0;
+    checkpoint("", 0);
+    for (char c : aText)
+        sum += sStatic.feed(c);
+    checkpoint("StaticStringFinder", aText.size());
+    std::cout << "Check: " << sum << ", table: " << TABLE.memory() << " bytes" << std::endl;
+}
+
+// Lines that match, RegexFinder over the stream vs std::regex per line.
+void runRegex(std::string_view aText, const char* aRegex)
+{
+    std::cout << "Regex: " << aRegex << std::endl;
+    RegexFinder<uint16_t> sFinder(aRegex);
+    size_t sum = 0;
+    bool sMatched = false;
+    checkpoint("", 0);
+    for (char c : aText)
+    {
+        sMatched |= sFinder.feed(c);
+        if (c == '\n')
+        {
+            sum += sMatched;
+            sMatched = false;
+        }
+    }
+    checkpoint("RegexFinder", aText.size());
+    std::cout << "Check: " << sum << ", states: " << sFinder.getStats().m_States << std::endl;
+
+    std::regex sRegex(aRegex);
+    sum = 0;
+    checkpoint("", 0);
+    for (size_t sPos = 0; sPos < aText.size(); )
+    {
+        size_t sEnd = aText.find('\n', sPos);
+        sEnd = sEnd == aText.npos ? aText.size() : sEnd;
+        sum += std::regex_search(aText.begin() + sPos, aText.begin() + sEnd, sRegex);
+        sPos = sEnd + 1;
+    }
+    checkpoint("std::regex", aText.size());
+    std::cout << "Check: " << sum << std::endl;
+}
+
+int main(int argc, char** argv)
+{
+    // Text size in MB.
+    size_t sSizeMB = argc > 1 ? atoll(argv[1]) : 64;
+    std::string sText = generateLogText(sSizeMB * 1024 * 1024);
+
+    for (size_t sCount : {1, 4, 16, 50})
+        runMulti(sText, sCount);
+    runLengths(sText);
+    for (std::string_view sNeedle : {"ERROR", "banned", " user", "id=123456", "2020-02-01 00:00:00", "not there"})
+        runFind(sText, sNeedle);
+    for (std::string_view sNeedle : {"ERROR", " user", "2020-02-01 00:00:00"})
+        runBulk(sText, sNeedle);
+    runPattern("error", sText, StringPattern<char>("error"));
+    runPattern("error (ignore case)", sText, StringPattern<char>("error", true));
+    runPattern("ip=1\\d\\d.", sText, StringPattern<char>().literal("ip=1").digit().digit().literal("."));
+    runPattern("\\d\\d\\d.\\d\\d\\d", sText, StringPattern<char>().digit().digit().digit().literal(".").digit().digit().digit());
+    runPattern("id=..0", sText, StringPattern<char>().literal("id=").any().any().literal("0"));
+    runStatic<sTableBanned>(sText, "banned");
+    runStatic<sTableIp>(sText, "ip=127.0.0.1 ");
+
+    // std::regex is too slow for the whole text.
+    std::string_view sRegexText = std::string_view(sText).substr(0, sText.find('\n', sText.size() / 16) + 1);
+    for (const char* sRegex : {"ERROR", "user (banned|closed)", "ip=1\\d+\\.\\d+\\.", "(WARN|ERROR).*(timeout|retry)$", "id=\\d*7\\d\\d "})
+        runRegex(sRegexText, sRegex);
+}
@@ -1,6 +1,7 @@
 #include <StringFinder.hpp>
 
 #include <iostream>
+#include <iterator>
 #include <stdexcept>
 
 void check(bool aExpession, const char* aMessage)
@@ -22,22 +23,70 @@ const char* var<unsigned char>() { return " (uchar)"; }
 template<>
 const char* var<int>() { return " (int)"; }
 template<>
+const char* var<short>() { return " (short)"; }
+template<>
+const char* var<unsigned>() { return " (unsigned)"; }
+template<>
 const char* var<size_t>() { return " (size_t)"; }
 
+template <class SIZE_TYPE>
+const char* name(const StringFinder<SIZE_TYPE>*) { return "StringFinder"; }
+template <class SIZE_TYPE>
+const char* name(const CompactStringFinder<SIZE_TYPE>*) { return "CompactStringFinder"; }
+
 std::vector<size_t> a; // StringFinder
 std::vector<size_t> b; // Reference;
 int rc = EXIT_SUCCESS;
 
-template <class SIZE_TYPE>
+template <template <class, class> class FINDER, class SIZE_TYPE>
 void calc_a(std::string_view aNeedle, std::string_view aHayStack)
 {
     a.clear();
-    StringFinder<SIZE_TYPE> cf(aNeedle);
+    FINDER<SIZE_TYPE, char> cf(aNeedle);
     for (size_t i = 0; i < aHayStack.size(); i++)
         if (cf.feed(aHayStack[i]))
             a.push_back(i + 1 - aNeedle.size());
 }
 
+// The same by find() over random pieces of the haystack.
+template <class SIZE_TYPE>
+void calc_a_find(std::string_view aNeedle, std::string_view aHayStack)
+{
+    a.clear();
+    StringFinder<SIZE_TYPE, char> cf(aNeedle);
+    size_t sFed = 0;
+    while (sFed < aHayStack.size())
+    {
+        std::string_view sPiece = aHayStack.substr(sFed, rand() % 2 ? aHayStack.size() : rand() % 64);
+        size_t sPos = cf.find(sPiece);
+        if (sPos == cf.npos)
+        {
+            sFed += sPiece.size();
+            continue;
+        }
+        sFed += sPos;
+        a.push_back(sFed - aNeedle.size());
+    }
+}
+
+// The same by the bulk feed() over random pieces of the haystack.
+template <class SIZE_TYPE>
+void calc_a_bulk(std::string_view aNeedle, std::string_view aHayStack)
+{
+    a.clear();
+    StringFinder<SIZE_TYPE, char> cf(aNeedle);
+    std::vector<size_t> sEnds;
+    for (size_t sFed = 0; sFed < aHayStack.size(); )
+    {
+        std::string_view sPiece = aHayStack.substr(sFed, rand() % 2 ? aHayStack.size() : rand() % 256);
+        sEnds.clear();
+        cf.feed(sPiece.data(), sPiece.data() + sPiece.size(), std::back_inserter(sEnds));
+        for (size_t sEnd : sEnds)
+            a.push_back(sFed + sEnd - aNeedle.size());
+        sFed += sPiece.size();
+    }
+}
+
 void calc_b(std::string_view aNeedle, std::string_view aHayStack)
 {
     b.clear();
@@ -51,14 +100,12 @@ void calc_b(std::string_view aNeedle, std::string_view aHayStack)
     }
 }
 
-template <class SIZE_TYPE>
-void compare(std::string_view aNeedle, std::string_view aHayStack)
+template <template <class, class> class FINDER, class SIZE_TYPE>
+void report(std::string_view aNeedle, std::string_view aHayStack)
 {
-    calc_a<SIZE_TYPE>(aNeedle, aHayStack);
-    calc_b(aNeedle, aHayStack);
     if (a != b)
     {
-        std::cout << "Wrong search of \"" <<  aNeedle << "\" in \"" << aHayStack << "\" " << var<SIZE_TYPE>() << "\n";
+        std::cout << name(static_cast<const FINDER<SIZE_TYPE, char>*>(nullptr)) << ": wrong search of \"" <<  aNeedle << "\" in \"" << aHayStack << "\" " << var<SIZE_TYPE>() << "\n";
         std::cout << "Found:    ";
         for (size_t i = 0; i < a.size(); i++)
             std::cout << (i ? ", " : "") << a[i];
@@ -67,32 +114,47 @@ void compare(std::string_view aNeedle, std::string_view aHayStack)
         for (size_t i = 0; i < b.size(); i++)
             std::cout << (i ? ", " : "") << b[i];
         std::cout << "\n";
-        rc = false;
+        rc = EXIT_FAILURE;
     }
 }
 
-template <class SIZE_TYPE>
+template <template <class, class> class FINDER, class SIZE_TYPE>
+void compare(std::string_view aNeedle, std::string_view aHayStack)
+{
+    calc_a<FINDER, SIZE_TYPE>(aNeedle, aHayStack);
+    calc_b(aNeedle, aHayStack);
+    report<FINDER, SIZE_TYPE>(aNeedle, aHayStack);
+    if constexpr (std::is_same_v<FINDER<SIZE_TYPE, char>, StringFinder<SIZE_TYPE, char>>)
+    {
+        calc_a_find<SIZE_TYPE>(aNeedle, aHayStack);
+        report<FINDER, SIZE_TYPE>(aNeedle, aHayStack);
+        calc_a_bulk<SIZE_TYPE>(aNeedle, aHayStack);
+        report<FINDER, SIZE_TYPE>(aNeedle, aHayStack);
+    }
+}
+
+template <template <class, class> class FINDER, class SIZE_TYPE>
 void simple_test()
 {
-    compare<SIZE_TYPE>("aba", "ababab");
-    compare<SIZE_TYPE>("abcabd", "abcabcabdabd");
-    compare<SIZE_TYPE>("aac", "aaaaaacaaaabaacaccaac");
-    compare<SIZE_TYPE>("ac", "aaaaaacaaaabaacaccaac");
-    compare<SIZE_TYPE>("a", "aaaaaacaaaabaacaccaac");
-    compare<SIZE_TYPE>("aaa", "aaaaaaaaaaaaaaaaaabaaaaaaaaaaaaaa");
-    compare<SIZE_TYPE>("aaa", "aabaabaabaabaabaabaabaab");
-    compare<SIZE_TYPE>("ab", "cdcdcdcd");
-    compare<SIZE_TYPE>("abc", "ab");
+    compare<FINDER, SIZE_TYPE>("aba", "ababab");
+    compare<FINDER, SIZE_TYPE>("abcabd", "abcabcabdabd");
+    compare<FINDER, SIZE_TYPE>("aac", "aaaaaacaaaabaacaccaac");
+    compare<FINDER, SIZE_TYPE>("ac", "aaaaaacaaaabaacaccaac");
+    compare<FINDER, SIZE_TYPE>("a", "aaaaaacaaaabaacaccaac");
+    compare<FINDER, SIZE_TYPE>("aaa", "aaaaaaaaaaaaaaaaaabaaaaaaaaaaaaaa");
+    compare<FINDER, SIZE_TYPE>("aaa", "aabaabaabaabaabaabaabaab");
+    compare<FINDER, SIZE_TYPE>("ab", "cdcdcdcd");
+    compare<FINDER, SIZE_TYPE>("abc", "ab");
     {
         constexpr size_t S = std::min(size_t(std::numeric_limits<SIZE_TYPE>::max()), size_t(64 * 1024));
         std::string s1(S, 'a');
         std::string s2(S, 'b');
-        compare<SIZE_TYPE>(s1, s1);
-        compare<SIZE_TYPE>(s1, s2);
+        compare<FINDER, SIZE_TYPE>(s1, s1);
+        compare<FINDER, SIZE_TYPE>(s1, s2);
     }
 }
 
-template <class SIZE_TYPE>
+template <template <class, class> class FINDER, class SIZE_TYPE>
 void massive_test()
 {
     const size_t ALPH = 8;
@@ -115,16 +177,174 @@ void massive_test()
             };
             gen(needle, nl, al);
             gen(haystack, nh, al);
-            compare<SIZE_TYPE>(needle, haystack);
+            compare<FINDER, SIZE_TYPE>(needle, haystack);
         }
     }
 }
 
+// Haystacks long enough for the vectorized skip, needles planted at random.
+template <template <class, class> class FINDER, class SIZE_TYPE>
+void long_test()
+{
+    const size_t ROUNDS = 64;
+    for (size_t i = 0; i < ROUNDS; i++)
+    {
+        size_t al = 2 + rand() % 7;
+        std::string needle;
+        for (size_t j = 1 + rand() % 16; j > 0; j--)
+            needle += static_cast<char>('a' + rand() % al);
+        std::string haystack;
+        for (size_t j = rand() % 4096; j > 0; j--)
+            haystack += rand() % 64 ? static_cast<char>('a' + al + rand() % 16) : static_cast<char>('a' + rand() % al);
+        for (size_t j = rand() % 8; j > 0 && !haystack.empty(); j--)
+            haystack.insert(rand() % haystack.size(), needle);
+        compare<FINDER, SIZE_TYPE>(needle, haystack);
+    }
+}
+
+// Pattern search by feed(), find() and the bulk feed() vs brute force.
 template <class SIZE_TYPE>
+void comparePattern(const StringPattern<char>& aPattern, std::string_view aHayStack)
+{
+    b.clear();
+    for (size_t i = 0; i + aPattern.size() <= aHayStack.size(); i++)
+    {
+        size_t j = 0;
+        while (j < aPattern.size() && aPattern[j].test(static_cast<unsigned char>(aHayStack[i + j])))
+            j++;
+        if (j == aPattern.size())
+            b.push_back(i);
+    }
+
+    StringFinder<SIZE_TYPE> sFinder(aPattern);
+    std::vector<size_t> sFed, sFound, sBulk;
+    for (size_t i = 0; i < aHayStack.size(); i++)
+        if (sFinder.feed(aHayStack[i]))
+            sFed.push_back(i + 1 - aPattern.size());
+    sFinder.restart();
+    for (size_t sFed = 0, sPos; (sPos = sFinder.find(aHayStack.substr(sFed))) != sFinder.npos; )
+    {
+        sFed += sPos;
+        sFound.push_back(sFed - aPattern.size());
+    }
+    sFinder.restart();
+    sFinder.feed(aHayStack.data(), aHayStack.data() + aHayStack.size(), std::back_inserter(sBulk));
+    for (size_t& sEnd : sBulk)
+        sEnd -= aPattern.size();
+
+    if (sFed != b || sFound != b || sBulk != b)
+    {
+        std::cout << "StringFinder: wrong pattern search in \"" << aHayStack << "\"" << var<SIZE_TYPE>() << "\n";
+        for (size_t i = 0; i < aPattern.size(); i++)
+        {
+            std::cout << "[";
+            for (size_t u = 0; u < aPattern[i].size(); u++)
+                if (aPattern[i].test(u))
+                    std::cout << static_cast<char>(u);
+            std::cout << "]";
+        }
+        std::cout << "\n";
+        rc = EXIT_FAILURE;
+    }
+}
+
+template <class SIZE_TYPE>
+void pattern_test()
+{
+    comparePattern<SIZE_TYPE>(StringPattern<char>("error", true), "ERROR Error error eRRoR erro");
+    comparePattern<SIZE_TYPE>(StringPattern<char>().literal("id=").digit().digit().digit(), "id=12 id=123 id=1234 id=a12");
+    comparePattern<SIZE_TYPE>(StringPattern<char>().literal("0x").hex().hex(), "0x1f 0xAB 0xg1 0x0x00");
+    comparePattern<SIZE_TYPE>(StringPattern<char>().oneOf("ab").any().literal("a"), "aaabababbbaaa");
+    comparePattern<SIZE_TYPE>(StringPattern<char>().any().any(), "abc");
+
+    // Letters in both cases, single characters, overlapping sets.
+    const size_t ROUNDS = 1024;
+    for (size_t i = 0; i < ROUNDS; i++)
+    {
+        size_t al = 2 + rand() % 4;
+        StringPattern<char> sPattern;
+        for (size_t j = 1 + rand() % 6; j > 0; j--)
+        {
+            char c = 'a' + rand() % al;
+            switch (rand() % 5)
+            {
+                case 0: sPattern.literal(std::string(1, c), true); break;
+                case 1: sPattern.oneOf(std::string(1, c) + static_cast<char>('a' + rand() % al)); break;
+                case 2: sPattern.range('a', c); break;
+                case 3: sPattern.any(); break;
+                default: sPattern.literal(std::string(1, c)); break;
+            }
+        }
+        std::string haystack;
+        for (size_t j = rand() % 256; j > 0; j--)
+            haystack += static_cast<char>((rand() % 4 ? 'a' : 'A') + rand() % al);
+        comparePattern<SIZE_TYPE>(sPattern, haystack);
+    }
+
+    bool sThrown = false;
+    try
+    {
+        StringFinder<SIZE_TYPE> sFinder(StringPattern<char>().literal("a").any().any().any().any().any().any().any().any().any().literal("b"));
+    }
+    catch (const std::runtime_error&)
+    {
+        sThrown = true;
+    }
+    CHECK(sThrown == (std::numeric_limits<SIZE_TYPE>::max() < 1024));
+}
+
+constexpr auto sTableA = makeStringTable("a");
+constexpr auto sTableAba = makeStringTable("aba");
+constexpr auto sTableAac = makeStringTable("aac");
+constexpr auto sTableAbcabd = makeStringTable("abcabd");
+static_assert(std::is_same_v<decltype(sTableAba)::size_type, uint8_t>);
+static_assert(std::is_same_v<StaticStringTable<255>::size_type, uint8_t>);
+static_assert(std::is_same_v<StaticStringTable<256>::size_type, uint16_t>);
+static_assert(std::is_same_v<StaticStringTable<65536>::size_type, uint32_t>);
+static_assert(sTableAba.next(0, 'a') == 1 && sTableAba.next(1, 'b') == 2 && sTableAba.next(2, 'a') == 3);
+static_assert(sTableAba.next(3, 'b') == 2 && sTableAba.next(2, 'b') == 0);
+static_assert(sTableAba.memory() == 4 * 256);
+
+template <const auto& TABLE>
+void compareStatic(const char* aNeedle, std::string_view aHayStack)
+{
+    a.clear();
+    StaticStringFinder<TABLE> sFinder;
+    for (size_t i = 0; i < aHayStack.size(); i++)
+        if (sFinder.feed(aHayStack[i]))
+            a.push_back(i + 1 - sFinder.size());
+    calc_b(aNeedle, aHayStack);
+    if (a != b)
+    {
+        std::cout << "StaticStringFinder: wrong search of \"" << aNeedle << "\" in \"" << aHayStack << "\"\n";
+        rc = EXIT_FAILURE;
+    }
+}
+
+void static_test()
+{
+    const size_t ROUNDS = 1024;
+    std::string haystack;
+    for (size_t i = 0; i < ROUNDS; i++)
+    {
+        haystack.clear();
+        for (size_t j = rand() % 128; j > 0; j--)
+            haystack += static_cast<char>('a' + rand() % 4);
+        compareStatic<sTableA>("a", haystack);
+        compareStatic<sTableAba>("aba", haystack);
+        compareStatic<sTableAac>("aac", haystack);
+        compareStatic<sTableAbcabd>("abcabd", haystack);
+    }
+}
+
+template <template <class, class> class FINDER, class SIZE_TYPE>
 void test()
 {
-    simple_test<SIZE_TYPE>();
-    massive_test<SIZE_TYPE>();
+    if constexpr (std::is_same_v<FINDER<SIZE_TYPE, char>, StringFinder<SIZE_TYPE, char>>)
+        pattern_test<SIZE_TYPE>();
+    simple_test<FINDER, SIZE_TYPE>();
+    massive_test<FINDER, SIZE_TYPE>();
+    long_test<FINDER, SIZE_TYPE>();
 }
 
 int main()
@@ -132,10 +352,15 @@ int main()
 
     try
     {
-        test<size_t>();
-        test<unsigned char>();
-        test<short>();
-        test<unsigned>();
+        test<StringFinder, size_t>();
+        test<StringFinder, unsigned char>();
+        test<StringFinder, short>();
+        test<StringFinder, unsigned>();
+        test<CompactStringFinder, size_t>();
+        test<CompactStringFinder, unsigned char>();
+        test<CompactStringFinder, short>();
+        test<CompactStringFinder, unsigned>();
+        static_test();
     }
     catch (const std::exception& e)
     {
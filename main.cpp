@@ -1,9 +1,364 @@
 #include <FileReader.hpp>
+#include <MultiStringFinder.hpp>
+#include <StringFinder.hpp>
 
-#include <iostream>
+#include <unistd.h>
 
-int main()
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+const size_t PAGE_SIZE = 64 * 1024;
+using Reader = FileReader<PAGE_SIZE>;
+
+const char* USAGE =
+    "Usage: banlog [OPTION]... PATTERN FILE...\n"
+    "       banlog [OPTION]... -e PATTERN... FILE...\n"
+    "Prints the lines of FILEs that contain any of the PATTERNs (fixed strings).\n"
+    "  -e PATTERN  a pattern, may be given several times\n"
+    "  -i          ignore case\n"
+    "  -c          print only the number of matching lines per file\n"
+    "  -l          print only the names of files with matches\n"
+    "  -n          prefix lines with their line numbers\n"
+    "  -b          prefix lines with their byte offsets\n"
+    "  -H, -h      always, never prefix lines with the file name\n"
+    "Exit status is 0 if a line matched, 1 if none, 2 on error.\n";
+
+struct Config
+{
+    std::vector<std::string> m_Patterns;
+    std::vector<std::string> m_Files;
+    bool m_IgnoreCase = false;
+    bool m_Count = false;
+    bool m_FilesOnly = false;
+    bool m_LineNumbers = false;
+    bool m_ByteOffsets = false;
+    bool m_FileNames = false;
+};
+
+// Collects the output and writes it to stdout in large blocks.
+class Output
+{
+public:
+    static constexpr size_t BUFFER_SIZE = 1024 * 1024;
+
+    Output() { m_Buf.reserve(BUFFER_SIZE); }
+    ~Output() { flush(); }
+    void append(std::string_view aText)
+    {
+        if (m_Buf.size() + aText.size() > BUFFER_SIZE)
+            flush();
+        m_Buf.append(aText);
+    }
+    void append(char c)
+    {
+        if (m_Buf.size() == BUFFER_SIZE)
+            flush();
+        m_Buf.push_back(c);
+    }
+    void append(size_t aNumber)
+    {
+        char sBuf[24];
+        int sLen = snprintf(sBuf, sizeof(sBuf), "%zu", aNumber);
+        append(std::string_view(sBuf, sLen));
+    }
+    void flush()
+    {
+        for (size_t sDone = 0; sDone < m_Buf.size(); )
+        {
+            ssize_t sWritten = write(STDOUT_FILENO, m_Buf.data() + sDone, m_Buf.size() - sDone);
+            if (sWritten < 0 && errno == EINTR)
+                continue;
+            if (sWritten <= 0)
+            {
+                m_Buf.clear();
+                throw std::runtime_error("Failed to write output");
+            }
+            sDone += sWritten;
+        }
+        m_Buf.clear();
+    }
+
+private:
+    std::string m_Buf;
+};
+
+// Several patterns by one automaton; fed per byte, it has no bulk search.
+// Ignores case by lower case patterns and input.
+class MultiFinder
+{
+public:
+    MultiFinder(const std::vector<std::string>& aPatterns, bool aIgnoreCase) : m_IgnoreCase(aIgnoreCase)
+    {
+        for (const std::string& sPattern : aPatterns)
+        {
+            m_Patterns.push_back(sPattern);
+            if (aIgnoreCase)
+                std::transform(m_Patterns.back().begin(), m_Patterns.back().end(), m_Patterns.back().begin(), lower);
+        }
+        m_Finder.create(std::vector<std::string_view>(m_Patterns.begin(), m_Patterns.end()));
+    }
+    template <class OutputIt>
+    OutputIt feed(const char* aBegin, const char* aEnd, OutputIt aMatches)
+    {
+        for (const char* p = aBegin; p != aEnd; ++p)
+        {
+            if (m_Finder.feed(m_IgnoreCase ? lower(*p) : *p))
+                *aMatches++ = p + 1 - aBegin;
+        }
+        return aMatches;
+    }
+    void restart() { m_Finder.restart(); }
+
+private:
+    static char lower(char c) { return static_cast<char>(tolower(static_cast<unsigned char>(c))); }
+
+    std::vector<std::string> m_Patterns;
+    MultiStringFinder<uint32_t> m_Finder;
+    bool m_IgnoreCase;
+};
+
+// Offset of the first '\n' at or after aPos, the file size if none.
+size_t findNewline(Reader& aReader, size_t aPos)
+{
+    for (Reader::iterator sItr = aReader.at(aPos); sItr != aReader.end(); )
+    {
+        std::string_view sSpan = sItr.span();
+        const void* sFound = memchr(sSpan.data(), '\n', sSpan.size());
+        if (sFound != nullptr)
+            return sItr.pos() + (static_cast<const char*>(sFound) - sSpan.data());
+        sItr.advance(sSpan.size());
+    }
+    return aReader.end().pos();
+}
+
+void writeRange(Output& aOut, Reader& aReader, size_t aBegin, size_t aEnd)
+{
+    for (Reader::iterator sItr = aReader.at(aBegin); sItr.pos() < aEnd; )
+    {
+        std::string_view sSpan = sItr.span().substr(0, aEnd - sItr.pos());
+        aOut.append(sSpan);
+        sItr.advance(sSpan.size());
+    }
+}
+
+// Streams the file through the finder page by page. A match is reported by
+// its end; its line starts after the last '\n' before it, in the page or in
+// the earlier ones, and the rest of the line is skipped. Line numbers count
+// '\n' up to the pages scanned so far. Returns the number of matching lines.
+template <class FINDER>
+size_t searchFile(const std::string& aFileName, FINDER& aFinder, const Config& aConfig, Output& aOut)
+{
+    Reader::Options sOptions;
+    sOptions.m_Source = Reader::Source::MMAP;
+    sOptions.m_ReadaheadPages = 8;
+    Reader sReader(aFileName, sOptions);
+    aFinder.restart();
+
+    size_t sMatched = 0;
+    size_t sLineStart = 0; // Of the line the last page ended in.
+    size_t sLineNo = 1;    // Of the line sCounted is in.
+    size_t sCounted = 0;
+    size_t sSkipTo = 0;    // After the last reported line.
+    std::vector<size_t> sEnds;
+    for (Reader::iterator sItr = sReader.begin(); sItr != sReader.end(); )
+    {
+        std::string_view sSpan = sItr.span();
+        size_t sPos = sItr.pos();
+        sEnds.clear();
+        aFinder.feed(sSpan.data(), sSpan.data() + sSpan.size(), std::back_inserter(sEnds));
+        for (size_t sEnd : sEnds)
+        {
+            if (sPos + sEnd <= sSkipTo)
+                continue;
+            sMatched++;
+            if (aConfig.m_FilesOnly)
+            {
+                aOut.append(aFileName);
+                aOut.append('\n');
+                return sMatched;
+            }
+            const void* sNewline = memrchr(sSpan.data(), '\n', sEnd - 1);
+            size_t sStart = sNewline != nullptr ? sPos + (static_cast<const char*>(sNewline) - sSpan.data()) + 1 : sLineStart;
+            size_t sFinish = findNewline(sReader, sPos + sEnd - 1);
+            sSkipTo = sFinish + 1;
+            if (aConfig.m_Count)
+                continue;
+            if (aConfig.m_FileNames)
+            {
+                aOut.append(aFileName);
+                aOut.append(':');
+            }
+            if (aConfig.m_LineNumbers)
+            {
+                size_t sFrom = std::max(sCounted, sPos);
+                if (sStart > sFrom)
+                {
+                    sLineNo += std::count(sSpan.data() + (sFrom - sPos), sSpan.data() + (sStart - sPos), '\n');
+                    sCounted = sStart;
+                }
+                aOut.append(sLineNo);
+                aOut.append(':');
+            }
+            if (aConfig.m_ByteOffsets)
+            {
+                aOut.append(sStart);
+                aOut.append(':');
+            }
+            writeRange(aOut, sReader, sStart, sFinish);
+            aOut.append('\n');
+        }
+        if (aConfig.m_LineNumbers)
+        {
+            size_t sFrom = std::max(sCounted, sPos);
+            sLineNo += std::count(sSpan.data() + (sFrom - sPos), sSpan.data() + sSpan.size(), '\n');
+            sCounted = sPos + sSpan.size();
+        }
+        const void* sNewline = memrchr(sSpan.data(), '\n', sSpan.size());
+        if (sNewline != nullptr)
+            sLineStart = sPos + (static_cast<const char*>(sNewline) - sSpan.data()) + 1;
+        sItr.advance(sSpan.size());
+    }
+    if (aConfig.m_Count)
+    {
+        if (aConfig.m_FileNames)
+        {
+            aOut.append(aFileName);
+            aOut.append(':');
+        }
+        aOut.append(sMatched);
+        aOut.append('\n');
+    }
+    return sMatched;
+}
+
+// Runs the search over all the files. Exit status like grep.
+template <class FINDER>
+int search(FINDER& aFinder, const Config& aConfig)
+{
+    Output sOut;
+    bool sFound = false;
+    bool sFailed = false;
+    for (const std::string& sFile : aConfig.m_Files)
+    {
+        try
+        {
+            sFound |= searchFile(sFile, aFinder, aConfig, sOut) != 0;
+        }
+        catch (const std::exception& e)
+        {
+            sOut.flush();
+            fprintf(stderr, "banlog: %s: %s\n", sFile.c_str(), e.what());
+            sFailed = true;
+        }
+    }
+    sOut.flush();
+    return sFailed ? 2 : sFound ? 0 : 1;
+}
+
+// grep-like options: flags may be combined (-cn), -e takes the rest of the
+// argument or the next one. A pattern with '\n' is several patterns.
+Config parse(int argc, char** argv)
+{
+    Config sConfig;
+    bool sExplicit = false;
+    bool sNoFileNames = false;
+    bool sOptions = true;
+    std::vector<std::string> sArgs;
+    for (int i = 1; i < argc; i++)
+    {
+        std::string_view sArg = argv[i];
+        if (!sOptions || sArg.size() < 2 || sArg[0] != '-')
+        {
+            sArgs.emplace_back(sArg);
+            continue;
+        }
+        if (sArg == "--")
+        {
+            sOptions = false;
+            continue;
+        }
+        for (size_t j = 1; j < sArg.size(); j++)
+        {
+            switch (sArg[j])
+            {
+            case 'e':
+                if (j + 1 < sArg.size())
+                    sConfig.m_Patterns.emplace_back(sArg.substr(j + 1));
+                else if (++i < argc)
+                    sConfig.m_Patterns.emplace_back(argv[i]);
+                else
+                    throw std::runtime_error("Option -e requires a pattern");
+                sExplicit = true;
+                j = sArg.size();
+                break;
+            case 'i': sConfig.m_IgnoreCase = true; break;
+            case 'c': sConfig.m_Count = true; break;
+            case 'l': sConfig.m_FilesOnly = true; break;
+            case 'n': sConfig.m_LineNumbers = true; break;
+            case 'b': sConfig.m_ByteOffsets = true; break;
+            case 'H': sConfig.m_FileNames = true; sNoFileNames = false; break;
+            case 'h': sNoFileNames = true; sConfig.m_FileNames = false; break;
+            default:
+                throw std::runtime_error(std::string("Unknown option -") + sArg[j]);
+            }
+        }
+    }
+    size_t sFirstFile = 0;
+    if (!sExplicit)
+    {
+        if (sArgs.empty())
+            throw std::runtime_error("No pattern");
+        sConfig.m_Patterns.push_back(sArgs[0]);
+        sFirstFile = 1;
+    }
+    sConfig.m_Files.assign(sArgs.begin() + sFirstFile, sArgs.end());
+    if (sConfig.m_Files.empty())
+        throw std::runtime_error("No file");
+    if (sConfig.m_Files.size() > 1 && !sNoFileNames)
+        sConfig.m_FileNames = true;
+
+    std::vector<std::string> sPatterns;
+    for (const std::string& sPattern : sConfig.m_Patterns)
+    {
+        for (size_t sBegin = 0; sBegin <= sPattern.size(); )
+        {
+            size_t sEnd = std::min(sPattern.find('\n', sBegin), sPattern.size());
+            if (sEnd == sBegin)
+                throw std::runtime_error("Empty pattern");
+            sPatterns.push_back(sPattern.substr(sBegin, sEnd - sBegin));
+            sBegin = sEnd + 1;
+        }
+    }
+    sConfig.m_Patterns = std::move(sPatterns);
+    return sConfig;
+}
+
+int main(int argc, char** argv)
 {
-    FileReader<128> test("./bannerd.log");
-    return 0;
-}
\ No newline at end of file
+    try
+    {
+        Config sConfig = parse(argc, argv);
+        if (sConfig.m_Patterns.size() == 1)
+        {
+            StringFinder<uint32_t> sFinder(sConfig.m_Patterns[0], sConfig.m_IgnoreCase);
+            return search(sFinder, sConfig);
+        }
+        MultiFinder sFinder(sConfig.m_Patterns, sConfig.m_IgnoreCase);
+        return search(sFinder, sConfig);
+    }
+    catch (const std::exception& e)
+    {
+        fprintf(stderr, "banlog: %s\n%s", e.what(), USAGE);
+        return 2;
+    }
+}